@@ -0,0 +1,63 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <cstddef>
+#include <cstdio>
+#include "IrcClock.h"
+
+// Timing shared by the micro-benchmarks (built with BUILD_BENCHMARKS)
+
+class BenchTimer {
+public:
+	BenchTimer() {
+		Start();
+	}
+
+	void Start() {
+		IrcClock::Update();
+		m_stStart = IrcClock::GetTime();
+	}
+
+	// Seconds since Start()
+	double GetElapsed() const {
+		IrcClock::Update();
+
+		const struct timeval &stNow = IrcClock::GetTime();
+
+		return (stNow.tv_sec - m_stStart.tv_sec) + (stNow.tv_usec - m_stStart.tv_usec)*1e-6;
+	}
+
+private:
+	struct timeval m_stStart;
+};
+
+inline void BenchReport(const char *pLabel, double elapsed, size_t count, const char *pUnit) {
+	printf("%-38s %8.1f ns/%s\n", pLabel, count != 0 ? elapsed*1e9/count : 0.0, pUnit);
+}
+
+#endif // !BENCH_H
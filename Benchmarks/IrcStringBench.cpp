@@ -0,0 +1,114 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "IrcString.h"
+#include "Bench.h"
+
+// Case folded compare, hash and match over nickname-like strings, per mapping
+// Usage: ircstringbench [rounds]
+
+namespace {
+	enum { NUM_STRINGS = 4096, DEFAULT_ROUNDS = 2000 };
+
+	volatile long s_sink = 0;
+
+	const char * const s_aMappingNames[] = { "RFC1459", "STRICT_RFC1459", "ASCII" };
+
+	void MakeStrings(std::vector<std::string> &vStrings) {
+		char aBuff[64];
+
+		vStrings.clear();
+
+		for (unsigned int i = 0; i < NUM_STRINGS; ++i) {
+			sprintf(aBuff, "%sNick%u[away]", (i % 2) ? "Some" : "some", i % 512);
+			vStrings.push_back(aBuff);
+		}
+	}
+
+	template<IrcCaseMapping Mapping>
+	void Run(const std::vector<std::string> &vStrings, int iRounds) {
+		const size_t count = (size_t)iRounds * (vStrings.size() - 1);
+		std::string strLabel;
+		BenchTimer clTimer;
+
+		// Neighbors differ in case or in the number, like lookups in a channel's member list
+		clTimer.Start();
+		for (int r = 0; r < iRounds; ++r) {
+			for (size_t i = 0; i + 1 < vStrings.size(); ++i)
+				s_sink += IrcStrCaseCmp(vStrings[i].c_str(), vStrings[i ^ 1].c_str(), Mapping);
+		}
+		strLabel = std::string("IrcStrCaseCmp ") + s_aMappingNames[Mapping];
+		BenchReport(strLabel.c_str(), clTimer.GetElapsed(), count, "call");
+
+		clTimer.Start();
+		for (int r = 0; r < iRounds; ++r) {
+			for (size_t i = 0; i + 1 < vStrings.size(); ++i)
+				s_sink += IrcStrCaseCmp<Mapping>(vStrings[i].c_str(), vStrings[i ^ 1].c_str());
+		}
+		strLabel = std::string("IrcStrCaseCmp<") + s_aMappingNames[Mapping] + '>';
+		BenchReport(strLabel.c_str(), clTimer.GetElapsed(), count, "call");
+
+		clTimer.Start();
+		for (int r = 0; r < iRounds; ++r) {
+			for (size_t i = 0; i + 1 < vStrings.size(); ++i)
+				s_sink += IrcStrCaseHash<Mapping>(vStrings[i].c_str());
+		}
+		strLabel = std::string("IrcStrCaseHash<") + s_aMappingNames[Mapping] + '>';
+		BenchReport(strLabel.c_str(), clTimer.GetElapsed(), count, "call");
+
+		clTimer.Start();
+		for (int r = 0; r < iRounds; ++r) {
+			for (size_t i = 0; i + 1 < vStrings.size(); ++i)
+				s_sink += IrcMatch<Mapping>("*nick*[away]", vStrings[i].c_str());
+		}
+		strLabel = std::string("IrcMatch<") + s_aMappingNames[Mapping] + "> *nick*[away]";
+		BenchReport(strLabel.c_str(), clTimer.GetElapsed(), count, "call");
+	}
+} // end namespace
+
+int main(int argc, char **argv) {
+	const int iRounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+
+	if (iRounds <= 0) {
+		fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> vStrings;
+
+	MakeStrings(vStrings);
+
+	printf("%u strings, %d rounds\n", (unsigned int)vStrings.size(), iRounds);
+
+	Run<RFC1459>(vStrings, iRounds);
+	Run<STRICT_RFC1459>(vStrings, iRounds);
+	Run<ASCII>(vStrings, iRounds);
+
+	return 0;
+}
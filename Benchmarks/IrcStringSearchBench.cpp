@@ -0,0 +1,152 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// The kernels live in an anonymous namespace, so this program compiles the search itself
+// NOTE: IrcStringSearch.cpp is not linked into this target
+#include "IrcStringSearch.cpp"
+#include "Bench.h"
+
+// IrcStrCaseNick, IrcStrCaseStr and each IrcStrCaseFind kernel (scalar, SSE2, AVX2) over synthetic channel traffic
+// Usage: ircsearchbench [rounds]
+
+namespace {
+	enum { NUM_LINES = 20000, DEFAULT_ROUNDS = 50 };
+
+	volatile size_t s_sink = 0;
+
+	// Chatter with the odd URL, about 2% of lines address the bot
+	void MakeLines(std::vector<std::string> &vLines) {
+		static const char * const a_pWords[] = { 
+			"hey", "lol", "anyone", "know", "how", "to", "fix", "this", "build", "error", "the", "kernel", 
+			"panic", "on", "boot", "thanks", "IRCBNX", "bot", "what", "is", "up", "with", "freebsd", "ports", 
+			"?", ":)", "http://example.com/some/long/path", "yeah", "no", "I", "think", "so"
+		};
+		const size_t numWords = sizeof(a_pWords)/sizeof(a_pWords[0]);
+
+		srand(11);
+
+		vLines.clear();
+
+		for (unsigned int i = 0; i < NUM_LINES; ++i) {
+			std::string strLine;
+
+			if (rand() % 50 == 0)
+				strLine = (rand() % 2) ? "ircbnx: " : "Ircbnx, ";
+
+			for (int j = rand() % 25 + 2; j > 0; --j) {
+				strLine += a_pWords[rand() % numWords];
+
+				if (j > 1)
+					strLine += ' ';
+			}
+
+			vLines.push_back(strLine);
+		}
+	}
+
+	void RunFind(const char *pLabel, FindFunction pFind, const std::vector<std::string> &vLines, const char *pLittle, int iRounds) {
+		const size_t littleLength = strlen(pLittle);
+		BenchTimer clTimer;
+
+		for (int r = 0; r < iRounds; ++r) {
+			for (size_t i = 0; i < vLines.size(); ++i) {
+				// The kernels assume IrcStrCaseFind's length check
+				if (vLines[i].size() >= littleLength)
+					s_sink += (*pFind)(vLines[i].c_str(), vLines[i].size(), pLittle, littleLength) != NULL;
+			}
+		}
+
+		BenchReport(pLabel, clTimer.GetElapsed(), iRounds * vLines.size(), "line");
+	}
+
+	template<IrcCaseMapping Mapping>
+	void RunKernels(const char *pMappingName, const std::vector<std::string> &vLines, const char *pLittle, int iRounds) {
+		std::string strLabel;
+
+		strLabel = std::string("scalar ") + pMappingName + " \"" + pLittle + '"';
+		RunFind(strLabel.c_str(), &FindScalar<Mapping>, vLines, pLittle, iRounds);
+
+#ifdef IRC_USE_SSE2
+		strLabel = std::string("SSE2 ") + pMappingName + " \"" + pLittle + '"';
+		RunFind(strLabel.c_str(), &FindSse2<Mapping>, vLines, pLittle, iRounds);
+#endif // IRC_USE_SSE2
+
+#ifdef IRC_USE_AVX2
+		if (__builtin_cpu_supports("avx2")) {
+			strLabel = std::string("AVX2 ") + pMappingName + " \"" + pLittle + '"';
+			RunFind(strLabel.c_str(), &FindAvx2<Mapping>, vLines, pLittle, iRounds);
+		}
+#endif // IRC_USE_AVX2
+	}
+} // end namespace
+
+int main(int argc, char **argv) {
+	const int iRounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+
+	if (iRounds <= 0) {
+		fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> vLines;
+
+	MakeLines(vLines);
+
+	size_t totalSize = 0;
+
+	for (size_t i = 0; i < vLines.size(); ++i)
+		totalSize += vLines[i].size();
+
+	printf("%u lines, %.1f bytes per line, %d rounds\n", (unsigned int)vLines.size(), 
+		(double)totalSize / vLines.size(), iRounds);
+
+	BenchTimer clTimer;
+
+	for (int r = 0; r < iRounds; ++r) {
+		for (size_t i = 0; i < vLines.size(); ++i)
+			s_sink += IrcStrCaseNick(vLines[i].c_str(), "ircbnx", RFC1459) != NULL;
+	}
+
+	BenchReport("IrcStrCaseNick RFC1459 \"ircbnx\"", clTimer.GetElapsed(), iRounds * vLines.size(), "line");
+
+	clTimer.Start();
+
+	for (int r = 0; r < iRounds; ++r) {
+		for (size_t i = 0; i < vLines.size(); ++i)
+			s_sink += IrcStrCaseStr(vLines[i].c_str(), "fuck", ASCII) != NULL;
+	}
+
+	BenchReport("IrcStrCaseStr ASCII \"fuck\"", clTimer.GetElapsed(), iRounds * vLines.size(), "line");
+
+	RunKernels<ASCII>("ASCII", vLines, "fuck", iRounds);
+	RunKernels<RFC1459>("RFC1459", vLines, "ircbnx", iRounds);
+
+	return 0;
+}
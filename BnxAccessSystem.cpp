@@ -48,10 +48,15 @@ std::ostream & operator<<(std::ostream &os, const BnxAccessSystem::UserEntry &cl
 void BnxAccessSystem::AddUser(const UserEntry &clNewEntry) {
 	EntryIterator entryItr = GetEntry(clNewEntry.GetHostmask());
 
-	if (entryItr == EntryEnd())
+	if (entryItr == EntryEnd()) {
 		m_vUserEntries.push_back(clNewEntry);
-	else
+		m_clIndex.Insert(clNewEntry.GetHostmask());
+	}
+	else {
+		// Equal hostmasks can still differ in case
 		*entryItr = clNewEntry;
+		Rebuild();
+	}
 }
 
 bool BnxAccessSystem::DeleteUser(const IrcUser &clHostmask) {
@@ -66,11 +71,14 @@ bool BnxAccessSystem::DeleteUser(const IrcUser &clHostmask) {
 }
 
 bool BnxAccessSystem::Login(const IrcUser &clUser, const std::string &strPassword) {
-	ConstEntryIterator entryItr;
+	const unsigned int entry = m_clIndex.FindMatch(clUser);
 
-	entryItr = std::find_if(EntryBegin(), EntryEnd(), EntryMatches(clUser));
+	if (entry == IrcMaskIndex::NO_MATCH)
+		return false;
 
-	if (entryItr == EntryEnd() || !entryItr->CheckPassword(strPassword))
+	ConstEntryIterator entryItr = EntryBegin() + entry;
+
+	if (!entryItr->CheckPassword(strPassword))
 		return false;
 
 	SessionIterator sessionItr = GetSession(clUser);
@@ -106,6 +114,13 @@ BnxAccessSystem::SessionIterator BnxAccessSystem::GetSession(const IrcUser &clUs
 	return itr;
 }
 
+void BnxAccessSystem::Rebuild() {
+	m_clIndex.Reset();
+
+	for (size_t i = 0; i < m_vUserEntries.size(); ++i)
+		m_clIndex.Insert(m_vUserEntries[i].GetHostmask());
+}
+
 void BnxAccessSystem::TimeoutSessions() {
 	SessionIterator itr = m_vUserSessions.begin();
 
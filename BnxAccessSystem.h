@@ -33,6 +33,8 @@
 #include <vector>
 #include "BnxListIo.h"
 #include "IrcUser.h"
+#include "IrcClock.h"
+#include "IrcMaskIndex.h"
 
 class BnxAccessSystem {
 public:
@@ -97,6 +99,7 @@ public:
 		std::string m_strPassword;
 	};
 
+	// NOTE: Hostmasks are indexed, do not modify entries through an EntryIterator
 	typedef std::vector<UserEntry>::iterator EntryIterator;
 	typedef std::vector<UserEntry>::const_iterator ConstEntryIterator;
 
@@ -106,7 +109,7 @@ public:
 		: m_iAccessLevel(0), m_lastAccessTime(0) { }
 
 		UserSession(const IrcUser &clUser, int iAccessLevel)
-		: m_clUser(clUser), m_iAccessLevel(iAccessLevel), m_lastAccessTime(time(NULL)) { }
+		: m_clUser(clUser), m_iAccessLevel(iAccessLevel), m_lastAccessTime(IrcClock::Now()) { }
 
 		const IrcUser & GetUser() const {
 			return m_clUser;
@@ -117,11 +120,11 @@ public:
 		}
 
 		time_t LastAccessTime() const {
-			return time(NULL)-m_lastAccessTime;
+			return IrcClock::Now()-m_lastAccessTime;
 		}
 
 		void Update() {
-			m_lastAccessTime = time(NULL);
+			m_lastAccessTime = IrcClock::Now();
 		}
 
 		bool operator==(const IrcUser &clUser) const {
@@ -186,7 +189,9 @@ public:
 
 	bool Load() {
 		Reset();
-		return BnxLoadList(m_strAccessListFile.c_str(), m_vUserEntries);
+		const bool bRet = BnxLoadList(m_strAccessListFile.c_str(), m_vUserEntries);
+		Rebuild();
+		return bRet;
 	}
 
 	void Save() const {
@@ -200,6 +205,7 @@ public:
 
 	bool DeleteUser(const IrcUser &clHostmask);
 	EntryIterator DeleteUser(EntryIterator entryItr) {
+		m_clIndex.Delete((unsigned int)(entryItr - EntryBegin()));
 		return m_vUserEntries.erase(entryItr);
 	}
 
@@ -229,23 +235,18 @@ public:
 	void Reset() {
 		m_vUserEntries.clear();
 		m_vUserSessions.clear();
+		m_clIndex.Reset();
 	}
 
 private:
-	struct EntryMatches {
-		EntryMatches(const IrcUser &clUser_)
-		: clUser(clUser_) { }
-	
-		bool operator()(const UserEntry &clEntry) const {
-			return clEntry.GetHostmask().Matches(clUser);
-		}
-
-		const IrcUser &clUser;
-	};
-
 	std::string m_strAccessListFile;
 	std::vector<UserEntry> m_vUserEntries;
 	std::vector<UserSession> m_vUserSessions;
+
+	// Hostmasks of m_vUserEntries, in the same order
+	IrcMaskIndex m_clIndex;
+
+	void Rebuild();
 };
 
 std::istream & operator>>(std::istream &is, BnxAccessSystem::UserEntry &clEntry);
@@ -24,6 +24,7 @@
  */
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <sstream>
 #include <ctime>
@@ -31,6 +32,7 @@
 #include "Irc.h"
 #include "IrcString.h"
 #include "IrcUser.h"
+#include "IrcClock.h"
 #include "BnxBot.h"
 #include "BnxDriver.h"
 
@@ -48,16 +50,25 @@ std::string BnxBot::GetVersionString() {
 	return versionStream.str();
 }
 
-BnxBot::BnxBot() {
+BnxBot::BnxBot()
+: m_clHostnames(ASCII), m_clSquelchList(m_clHostnames), m_clSeenList(m_clHostnames) {
+	m_clFloodDetector.SetHostnamePool(&m_clHostnames);
+
 	m_strLogFile = "bot.log";
 	m_bChatter = true;
+	m_iSquelchTime = 3600;
+
+	// Default responses until rules are loaded
+	m_pResponseEngine = BnxResponseEngineCache::EnginePtr(new BnxResponseEngine());
 
-	m_clConnectTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnConnectTimer>(this);
-	m_clFloodTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnFloodTimer>(this);
-	m_clVoteBanTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnVoteBanTimer>(this);
-	m_clChannelsTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnChannelsTimer>(this);
-	m_clAntiIdleTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnAntiIdleTimer>(this);
-	m_clSeenListTimer = IrcEvent::Bind<BnxBot, &BnxBot::OnSeenListTimer>(this);
+	m_clConnectTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnConnectTimer>(this);
+	m_clFloodTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnFloodTimer>(this);
+	m_clVoteBanTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnVoteBanTimer>(this);
+	m_clChannelsTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnChannelsTimer>(this);
+	m_clAntiIdleTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnAntiIdleTimer>(this);
+	m_clSeenListTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnSeenListTimer>(this);
+	m_clSeenSearchTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnSeenSearchTimer>(this);
+	m_clCtcpTimer = IrcTimer::Bind<BnxBot, &BnxBot::OnCtcpTimer>(this);
 }
 
 BnxBot::~BnxBot() {
@@ -72,6 +83,10 @@ const std::string & BnxBot::GetProfileName() const {
 	return m_strProfileName;
 }
 
+const BnxCtcpResponder & BnxBot::GetCtcpResponder() const {
+	return m_clCtcpResponder;
+}
+
 void BnxBot::SetServerAndPort(const std::string &strServer, const std::string &strPort) {
 	m_strServer = strServer;
 	m_strPort = strPort;
@@ -123,7 +138,16 @@ bool BnxBot::LoadResponseRules(const std::string &strFilename) {
 	if (!responseStream)
 		return false;
 
-	return m_clResponseEngine.LoadFromStream(responseStream);
+	BnxResponseEngine *pResponseEngine = new BnxResponseEngine();
+
+	m_pResponseEngine = BnxResponseEngineCache::EnginePtr(pResponseEngine);
+
+	return pResponseEngine->LoadFromStream(responseStream);
+}
+
+void BnxBot::SetResponseEngine(const BnxResponseEngineCache::EnginePtr &pResponseEngine) {
+	if (!pResponseEngine.IsNull())
+		m_pResponseEngine = pResponseEngine;
 }
 
 bool BnxBot::LoadAccessList(const std::string &strFilename) {
@@ -148,6 +172,14 @@ void BnxBot::SetLogFile(const std::string &strLogFile) {
 	m_strLogFile = strLogFile;
 }
 
+void BnxBot::SetSquelchTime(int iSquelchTime) {
+	m_iSquelchTime = iSquelchTime;
+}
+
+void BnxBot::SetSquelchListSize(size_t maxSize) {
+	m_clSquelchList.SetMaxSize(maxSize);
+}
+
 void BnxBot::StartUp() {
 	if (m_clConnectTimer)
 		return;
@@ -155,12 +187,14 @@ void BnxBot::StartUp() {
 	Log("Starting up ...");
 	Log("Version: %s", GetVersionString().c_str());
 
-	m_clConnectTimer.NewTimer(GetEventBase(), 0);
-	m_clFloodTimer.NewTimer(GetEventBase(), EV_PERSIST);
-	m_clVoteBanTimer.NewTimer(GetEventBase(), EV_PERSIST);
-	m_clChannelsTimer.NewTimer(GetEventBase(), EV_PERSIST);
-	m_clAntiIdleTimer.NewTimer(GetEventBase(), EV_PERSIST);
-	m_clSeenListTimer.NewTimer(GetEventBase(), EV_PERSIST);
+	m_clConnectTimer.NewTimer(GetTimerWheel(), 0);
+	m_clFloodTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clVoteBanTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clChannelsTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clAntiIdleTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clSeenListTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clSeenSearchTimer.NewTimer(GetTimerWheel(), 0);
+	m_clCtcpTimer.NewTimer(GetTimerWheel(), 0);
 
 	struct timeval tv;
 	tv.tv_sec = tv.tv_usec = 0;
@@ -180,6 +214,8 @@ void BnxBot::Shutdown() {
 	m_clChannelsTimer.Free();
 	m_clAntiIdleTimer.Free();
 	m_clSeenListTimer.Free();
+	m_clSeenSearchTimer.Free();
+	m_clCtcpTimer.Free();
 }
 
 void BnxBot::Disconnect() {
@@ -190,11 +226,16 @@ void BnxBot::Disconnect() {
 	m_clChannelsTimer.Delete();
 	m_clAntiIdleTimer.Delete();
 	m_clSeenListTimer.Delete();
+	m_clSeenSearchTimer.Delete();
+	m_clCtcpTimer.Delete();
 
 	m_vCurrentChannels.clear();
-	m_vSquelchedUsers.clear();
+	m_dqSeenSearches.clear();
+	m_clSquelchList.Reset();
 	m_clAccessSystem.ResetSessions();
 	m_clFloodDetector.Reset();
+	m_clCtcpResponder.Reset();
+	m_clChannelSync.Reset();
 }
 
 BnxBot::ChannelIterator BnxBot::ChannelBegin() {
@@ -211,8 +252,7 @@ void BnxBot::Log(const char *pFormat, ...) {
 	if (pFile == NULL)
 		return;
 
-	time_t rawTime = 0;
-	time(&rawTime);
+	time_t rawTime = IrcClock::WallNow();
 	
 	// XXX: Not thread-safe
 	struct tm *pLocalTime = localtime(&rawTime);
@@ -513,11 +553,11 @@ bool BnxBot::ProcessVoteBan(const char *pSource, const char *pTarget, const char
 	IrcUser clUser(pSource);
 
 	if (!IrcStrCaseCmp(pMessage,"yea")) {
-		channelItr->VoteYay(clUser.GetNickname());
+		channelItr->VoteYay(clUser.GetNickname().c_str());
 		return true;
 	}
 	else if (!IrcStrCaseCmp(pMessage,"nay")) {
-		channelItr->VoteNay(clUser.GetNickname());
+		channelItr->VoteNay(clUser.GetNickname().c_str());
 		return true;
 	}
 
@@ -530,13 +570,13 @@ void BnxBot::ProcessMessage(const char *pSource, const char *pTarget, const char
 		return;
 
 	IrcUser clUser(pSource);
-	const std::string &strSourceNick = clUser.GetNickname();
+	const IrcStringView clSourceNick = clUser.GetNickname();
 
 	// Don't respond to self
-	if (IsMe(strSourceNick))
+	if (IsMe(clSourceNick.c_str()))
 		return;
 
-	const char *pReplyTo = strSourceNick.c_str();
+	const char *pReplyTo = clSourceNick.c_str();
 	std::string strPrefix;
 
 	if (!IsMe(pTarget)) {
@@ -546,7 +586,8 @@ void BnxBot::ProcessMessage(const char *pSource, const char *pTarget, const char
 		if (channelItr == ChannelEnd())
 			return;
 
-		if (channelItr->GetSize() != 2 && 
+		// Until the members are known, only answer when addressed
+		if ((!channelItr->IsSynced() || channelItr->GetSize() != 2) && 
 			IrcStrCaseNick(pMessage,GetCurrentNickname().c_str()) == NULL) {
 			return;
 		}
@@ -557,7 +598,7 @@ void BnxBot::ProcessMessage(const char *pSource, const char *pTarget, const char
 		if (channelItr->IsOperator() && IrcStrCaseStr(pMessage,"fuck") != NULL) {
 			Send(LATER, "PRIVMSG %s :I don't appreciate being spoken to in that manner, %s.\r\n", 
 					pTarget, clUser.GetNickname().c_str());
-			Send(LATER, "MODE %s +b %s\r\n", pTarget, clUser.GetBanMask().c_str());
+			Ban(LATER, pTarget, clUser.GetBanMask());
 			Send(LATER, "KICK %s %s :for inappropriate language\r\n", pTarget, 
 					clUser.GetNickname().c_str());
 
@@ -565,7 +606,7 @@ void BnxBot::ProcessMessage(const char *pSource, const char *pTarget, const char
 		}
 
 		pReplyTo = pTarget;
-		strPrefix = strSourceNick;
+		strPrefix.assign(clSourceNick.data(), clSourceNick.size());
 		strPrefix += ": ";
 	}
 
@@ -573,21 +614,21 @@ void BnxBot::ProcessMessage(const char *pSource, const char *pTarget, const char
 		return;
 
 	if (IrcMatch("*shut*up*", pMessage)) {
-		Squelch(IrcUser("*", "*", clUser.GetHostname()));
+		m_clSquelchList.Squelch(IrcUser("*", "*", clUser.GetHostname()), m_iSquelchTime);
 
 		Send(AUTO, "PRIVMSG %s :%sOK, I won't talk to you anymore.\r\n", pReplyTo, strPrefix.c_str());
 		return;
 	}
 
-	std::string strResponse = m_clResponseEngine.ComputeResponse(pMessage);
+	std::string strResponse = m_pResponseEngine->ComputeResponse(pMessage);
 
 	if (strResponse[0] == '/')
 		strPrefix.clear();
 
 	size_t findPos = 0;
 	while ((findPos = strResponse.find("%s", findPos)) != std::string::npos) {
-		strResponse.replace(findPos, 2, strSourceNick);
-		findPos += strSourceNick.size();
+		strResponse.replace(findPos, 2, clSourceNick.data(), clSourceNick.size());
+		findPos += clSourceNick.size();
 	}
 	
 	Say(AUTO, pReplyTo, "%s%s", strPrefix.c_str(), strResponse.c_str());
@@ -636,110 +677,171 @@ void BnxBot::Say(WhenType eWhen, const char *pTarget, const char *pFormat, ...)
 }
 
 BnxBot::ChannelIterator BnxBot::GetChannel(const char *pChannel) {
-	return std::find(ChannelBegin(), ChannelEnd(), pChannel);
+	const IrcKey clChannel(pChannel, GetIrcTraits().GetCaseMapping());
+
+	return std::find(ChannelBegin(), ChannelEnd(), clChannel);
 }
 
 bool BnxBot::IsSquelched(const IrcUser &clUser) {
-	return std::find_if(m_vSquelchedUsers.begin(), 
-				m_vSquelchedUsers.end(), 
-				MaskMatches(clUser)) != m_vSquelchedUsers.end();
+	return m_clSquelchList.IsSquelched(clUser);
 }
 
 void BnxBot::SplatterKick(const char *pChannel, const IrcUser &clUser) {
-	const std::string &strNickname = clUser.GetNickname();
+	const char * const pNickname = clUser.GetNickname().c_str();
 
 	switch(rand() % 12) {
 	case 0:
 		Say(LATER, pChannel, "Congratulations, %s - you're the lucky winner of a one-way trip to The Void!", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :don't forget to write!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :don't forget to write!\r\n", pChannel, pNickname);
 		break;
 	case 1:
-		Say(LATER, pChannel, "%s: What is your real name?", strNickname.c_str());
-		Say(LATER, pChannel, "%s: What is your quest?", strNickname.c_str());
+		Say(LATER, pChannel, "%s: What is your real name?", pNickname);
+		Say(LATER, pChannel, "%s: What is your quest?", pNickname);
 		Say(LATER, pChannel, "%s: What is the average velocity of a coconut-laden swallow?", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s\r\n", pChannel, pNickname);
 		Say(LATER, pChannel, "I guess he didn't know!");
 		break;
 	case 2:
 		Say(LATER, pChannel, "/me smells something bad...");
-		Say(LATER, pChannel, "/me looks at %s...", strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :Ah! Smell's gone!!\r\n", pChannel, strNickname.c_str());
+		Say(LATER, pChannel, "/me looks at %s...", pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :Ah! Smell's gone!!\r\n", pChannel, pNickname);
 		break;
 	case 3:
 		Say(LATER, pChannel, "/me says \"YER OUTTA HERE, PAL!\"");
 		Say(LATER, pChannel, "/me takes %s by the balls and throws him into The Void.", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :AND STAY OUT!!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :AND STAY OUT!!\r\n", pChannel, pNickname);
 		break;
 	case 4:
 		Say(LATER, pChannel, "It's April, the season of growing, and the F-ing weeds are popping up everywhere.");
 		Say(LATER, pChannel, "/me spots a weed in %s", pChannel);
 		Say(LATER, pChannel, "/me grabs a bottle of Round-Up and spritzes %s liberally.", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :FSSST! Weed's gone!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :FSSST! Weed's gone!\r\n", pChannel, pNickname);
 		break;
 	case 5:
 		Say(LATER, pChannel, "/me pulls out his portable chalkboard.");
 		Say(LATER, pChannel, "/me shows %s the function of relativity for chaos mathematics.", 
-				strNickname.c_str());
+				pNickname);
 		Say(LATER, pChannel, "/me watches as %s's brain shorts out with a puff of putrid smoke!", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :zzzzzttttt!!!!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :zzzzzttttt!!!!\r\n", pChannel, pNickname);
 		break;
 	case 6:
 		Say(LATER, pChannel, "/me bashes %s's head in with a baseball bat *BOK*!!", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s\r\n", pChannel, strNickname.c_str());
-		Say(LATER, pChannel, "/me wipes the blood off on %s's hair.", strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s\r\n", pChannel, pNickname);
+		Say(LATER, pChannel, "/me wipes the blood off on %s's hair.", pNickname);
 		break;
 	case 7:
 		Say(LATER, pChannel, "/me gags %s, stuffs him into a cow suit, then tosses him into a corral with a horny bull.", 
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :Moooo!!!!!!!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :Moooo!!!!!!!\r\n", pChannel, pNickname);
 		break;
 	case 8:
 		Say(LATER, pChannel, "/me grabs %s by the hair and jams his face into the toilet.", 
-				strNickname.c_str());
+				pNickname);
 		Say(LATER, pChannel, "/me does the royal flush.");
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :KA-WIIIISSSHHHHHHHHH!!!\r\n", pChannel, strNickname.c_str());
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :KA-WIIIISSSHHHHHHHHH!!!\r\n", pChannel, pNickname);
 		break;
 	case 9:
 		Say(LATER, pChannel, "/me casts a Fireball that goes streaking across the channel at %s", 
-				strNickname.c_str());
+				pNickname);
 		Say(LATER, pChannel, "/me watches as %s's corporeal form is enveloped in flame!",
-				strNickname.c_str());
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :poof!!\r\n", pChannel, strNickname.c_str());
+				pNickname);
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :poof!!\r\n", pChannel, pNickname);
 		break;
 	case 10:
 		Say(LATER, pChannel, "/me grabs %s's tongue and pulls it waaaaay out.", 
-			strNickname.c_str());
+			pNickname);
 		Say(LATER, pChannel, "/me takes out the locking ring and loops it through %s's tongue.",
-			strNickname.c_str());
+			pNickname);
 		Say(LATER, pChannel, "/me then fastens the ring to the bumper of his Porsche and drives off.");
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s :what a drag!\r\n", pChannel, strNickname.c_str());
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s :what a drag!\r\n", pChannel, pNickname);
 		break;
 	case 11:
 		Say(LATER, pChannel, "/me pulls down the switch on the electric chair.");
-		Send(LATER, "MODE %s +b %s\r\n", pChannel, clUser.GetBanMask().c_str());
-		Send(LATER, "KICK %s %s\r\n", pChannel, strNickname.c_str());
-		Say(LATER, pChannel, "/me makes an omelette with %s's brains.", strNickname.c_str());
+		Ban(LATER, pChannel, clUser.GetBanMask());
+		Send(LATER, "KICK %s %s\r\n", pChannel, pNickname);
+		Say(LATER, pChannel, "/me makes an omelette with %s's brains.", pNickname);
 		break;
 	}
 }
 
+void BnxBot::Ban(WhenType eWhen, const char *pChannel, const std::string &strMask) {
+	ChannelIterator channelItr = GetChannel(pChannel);
+
+	if (channelItr == ChannelEnd()) {
+		Send(eWhen, "MODE %s +b %s\r\n", pChannel, strMask.c_str());
+		return;
+	}
+
+	// Pending bans count too, they're dropped if the server refuses them
+	if (channelItr->HasListEntry('b', strMask))
+		return;
+
+	const IrcTraits &clTraits = GetIrcTraits();
+	IrcTraits::LimitIterator limitItr = clTraits.GetMaxList('b');
+
+	// Only rotate once the whole list is known, otherwise the server says when it is full (ERR_BANLISTFULL)
+	if (limitItr != clTraits.MaxListEnd() && channelItr->IsListSynced('b')) {
+		// Modes grouped in MAXLIST share the limit
+		size_t listSize = 0;
+
+		for (size_t i = 0; i < limitItr->first.size(); ++i)
+			listSize += channelItr->GetListSize(limitItr->first[i]);
+
+		if (listSize >= limitItr->second) {
+			BnxChannel::ConstListIterator oldestItr = channelItr->GetOldestOwnListEntry('b');
+
+			if (oldestItr == channelItr->ListEnd('b')) {
+				Log("Not banning %s from %s, the ban list is full.", strMask.c_str(), pChannel);
+				return;
+			}
+
+			const std::string strOldMask = oldestItr->GetMask();
+
+			// Kept until the server echoes the removal, a refused MODE leaves that ban set
+			channelItr->SetListEntryRemoving('b', strOldMask, IrcClock::WallNow());
+			channelItr->AddListEntry('b', strMask, true, IrcClock::WallNow(), true);
+
+			Send(eWhen, "MODE %s -b+b %s %s\r\n", pChannel, strOldMask.c_str(), strMask.c_str());
+			return;
+		}
+	}
+
+	// Recorded now so that repeated bans aren't sent before the server echoes this one
+	channelItr->AddListEntry('b', strMask, true, IrcClock::WallNow(), true);
+
+	Send(eWhen, "MODE %s +b %s\r\n", pChannel, strMask.c_str());
+}
+
+char BnxBot::GetListMode(int numeric) const {
+	switch (numeric) {
+	case RPL_EXCEPTLIST:
+	case RPL_ENDOFEXCEPTLIST:
+		return GetIrcTraits().GetExcepts() != '\0' ? GetIrcTraits().GetExcepts() : 'e';
+	case RPL_INVITELIST:
+	case RPL_ENDOFINVITELIST:
+		return GetIrcTraits().GetInvex() != '\0' ? GetIrcTraits().GetInvex() : 'I';
+	}
+
+	return 'b';
+}
+
 void BnxBot::OnConnect() {
 	IrcClient::OnConnect();
 }
@@ -777,15 +879,19 @@ void BnxBot::OnRegistered() {
 	tv.tv_sec = 300;
 	m_clSeenListTimer.Add(&tv);
 
-	if (IsMe(GetNickname()) &&
+	// Already identified with SASL
+	if (IsMe(GetNickname()) && !IsLoggedIn() &&
 		!m_strNickServ.empty() && !m_strNickServPassword.empty()) {
 		Send(AUTO, "PRIVMSG %s :identify %s\r\n", m_strNickServ.c_str(), 
 			m_strNickServPassword.c_str());
 	}
 
-	for (size_t i = 0; i < m_vHomeChannels.size(); ++i) {
-		Send(AUTO, "JOIN %s\r\n", m_vHomeChannels[i].c_str());
-	}
+	m_clChannelSync.SetCaseMapping(GetIrcTraits().GetCaseMapping());
+
+	for (size_t i = 0; i < m_vHomeChannels.size(); ++i)
+		m_clChannelSync.QueueJoin(m_vHomeChannels[i]);
+
+	SyncChannels();
 }
 
 void BnxBot::OnNumeric(const char *pSource, int numeric, const char *pParams[], unsigned int numParams) {
@@ -801,40 +907,70 @@ void BnxBot::OnNumeric(const char *pSource, int numeric, const char *pParams[],
 		pTrailing = pParams[numParams-1];
 		pChannel = pParams[numParams-2];
 
-		if (GetChannel(pChannel) != ChannelEnd())
-			return;
+		channelItr = GetChannel(pChannel);
 
 		// Check if we joined a channel
 
 		// RFC1459 only guarantees RPL_NAMEREPLY or RPL_TOPIC (with which there isn't always a topic)
-		{
+		if (channelItr == ChannelEnd()) {
 			std::stringstream nameStream(pTrailing);
 
-			std::string strNickname;
+			std::string strName;
 
-			while (nameStream >> strNickname) {
-				size_t p;
-				for (p = 0; p < strNickname.size() &&
-						!isalpha(strNickname[p]) &&
-						!IrcIsSpecial(strNickname[p]); ++p);
+			while (nameStream >> strName) {
+				if (IsMe(ParseName(strName).GetNickname().c_str())) {
+					JoinedChannel(pChannel);
+					break;
+				}
+			}
 
-				if (p < strNickname.size() && IsMe(strNickname.substr(p))) {
-					AddChannel(pChannel);
+			channelItr = GetChannel(pChannel);
 
-					// Now really collect useful information
-					Send(AUTO, "WHO %s\r\n", pChannel);
-					return;
-				}
+			if (channelItr == ChannelEnd())
+				return;
+		}
+
+		// Otherwise members are collected with WHO
+		if (HasCapability(CAP_USERHOST_IN_NAMES)) {
+			std::stringstream nameStream(pTrailing);
+
+			std::string strName;
+
+			while (nameStream >> strName) {
+				bool bOperator = false;
+				IrcUser clUser = ParseName(strName, &bOperator);
+
+				channelItr->AddMember(clUser);
+				m_clSeenList.Saw(clUser, pChannel, GetMessageTime());
+
+				if (bOperator && IsMe(clUser.GetNickname().c_str()))
+					channelItr->SetOperator(true);
 			}
 		}
 
 		break;
 	case RPL_WHOREPLY:
-		pChannel = pParams[1];
-		pUsername = pParams[2];
-		pHostname = pParams[3];
-		pNickname = pParams[5];
-		pMode = pParams[6];
+	case RPL_WHOSPCRPL:
+		if (numeric == RPL_WHOREPLY) {
+			pChannel = pParams[1];
+			pUsername = pParams[2];
+			pHostname = pParams[3];
+			pNickname = pParams[5];
+			pMode = pParams[6];
+		}
+		else {
+			// Fields come in the order <token> <channel> <user> <host> <nick> <flags>, only answer our own queries
+			if (numParams < 7 || atoi(pParams[1]) != WHOX_MEMBERS_TOKEN)
+				break;
+
+			pChannel = pParams[2];
+			pUsername = pParams[3];
+			pHostname = pParams[4];
+			pNickname = pParams[5];
+			pMode = pParams[6];
+		}
+
+		m_clChannelSync.NoteReply(pChannel);
 
 		channelItr = GetChannel(pChannel);
 
@@ -844,16 +980,104 @@ void BnxBot::OnNumeric(const char *pSource, int numeric, const char *pParams[],
 		{
 			IrcUser clUser(pNickname,pUsername,pHostname);
 			channelItr->AddMember(clUser);
-			m_clSeenList.Saw(clUser, pChannel);
+			m_clSeenList.Saw(clUser, pChannel, GetMessageTime());
 		}
 
+		channelItr->GetMember(pNickname)->SetAway(pMode[0] == 'G');
+
 		if (IsMe(pNickname) && strchr(pMode,'@') != NULL)
 			channelItr->SetOperator(true);
 
+		break;
+	case RPL_ENDOFWHO:
+		pChannel = pParams[1];
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr != ChannelEnd())
+			channelItr->SetSynced(true);
+
+		break;
+	case RPL_ENDOFNAMES:
+		pChannel = pParams[1];
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr != ChannelEnd() && HasCapability(CAP_USERHOST_IN_NAMES))
+			channelItr->SetSynced(true);
+
+		break;
+	case RPL_BANLIST:
+	case RPL_EXCEPTLIST:
+	case RPL_INVITELIST:
+		if (numParams < 3)
+			break;
+
+		pChannel = pParams[1];
+
+		m_clChannelSync.NoteReply(pChannel);
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr == ChannelEnd())
+			break;
+
+		{
+			// Who set it and when are optional
+			const bool bMine = numParams > 3 && IsMe(IrcUser(pParams[3]).GetNickname().c_str());
+			const time_t timeStamp = numParams > 4 ? (time_t)strtol(pParams[4], NULL, 10) : GetMessageTime();
+
+			channelItr->AddListEntry(GetListMode(numeric), pParams[2], bMine, timeStamp);
+		}
+
+		break;
+	case RPL_ENDOFBANLIST:
+	case RPL_ENDOFEXCEPTLIST:
+	case RPL_ENDOFINVITELIST:
+		pChannel = pParams[1];
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr != ChannelEnd())
+			channelItr->SetListSynced(GetListMode(numeric));
+
+		if (numeric == RPL_ENDOFBANLIST && m_clChannelSync.FinishQuery(pChannel))
+			SyncChannels();
+
 		break;
 	case ERR_NOSUCHCHANNEL:
 		pChannel = pParams[1];
 		DeleteHomeChannels(pChannel);
+		break;
+	case ERR_BANLISTFULL:
+		if (numParams < 2)
+			break;
+
+		pChannel = pParams[1];
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr == ChannelEnd())
+			break;
+
+		// Some servers name the refused mask, otherwise drop all the bans (and restore the removals) still waiting
+		if (numParams < 4 || !channelItr->DeletePendingListEntry('b', pParams[2]))
+			channelItr->DeletePendingListEntries(IrcClock::WallNow());
+
+		Log("The ban list of %s is full.", pChannel);
+
+		break;
+	case ERR_CHANOPRIVSNEEDED:
+		if (numParams < 2)
+			break;
+
+		pChannel = pParams[1];
+
+		channelItr = GetChannel(pChannel);
+
+		if (channelItr != ChannelEnd() && channelItr->DeletePendingListEntries(IrcClock::WallNow()) > 0)
+			Log("Not a channel operator on %s, dropped the bans still waiting.", pChannel);
+
 		break;
 	case ERR_ERRONEUSNICKNAME:
 		// If this happens, the bot never even registers ... 
@@ -873,7 +1097,29 @@ void BnxBot::OnNick(const char *pSource, const char *pNewNick) {
 	IrcUser clUser(pSource);
 
 	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i) 
-		m_vCurrentChannels[i].UpdateMember(clUser.GetNickname(), pNewNick);
+		m_vCurrentChannels[i].UpdateMember(clUser.GetNickname().c_str(), pNewNick);
+}
+
+void BnxBot::OnChghost(const char *pSource, const char *pNewUsername, const char *pNewHostname) {
+	IrcClient::OnChghost(pSource, pNewUsername, pNewHostname);
+
+	IrcUser clUser(pSource);
+
+	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i)
+		m_vCurrentChannels[i].UpdateMemberHost(clUser.GetNickname().c_str(), pNewUsername, pNewHostname);
+}
+
+void BnxBot::OnAway(const char *pSource, const char *pMessage) {
+	IrcClient::OnAway(pSource, pMessage);
+
+	IrcUser clUser(pSource);
+
+	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i) {
+		BnxChannel::MemberIterator memberItr = m_vCurrentChannels[i].GetMember(clUser.GetNickname().c_str());
+
+		if (memberItr != m_vCurrentChannels[i].MemberEnd())
+			memberItr->SetAway(pMessage != NULL);
+	}
 }
 
 void BnxBot::OnKick(const char *pSource, const char *pChannel, const char *pUser, const char *pReason) {
@@ -900,42 +1146,18 @@ void BnxBot::OnKick(const char *pSource, const char *pChannel, const char *pUser
 	channelItr->DeleteMember(pUser);
 }
 
-void BnxBot::OnPrivmsg(const char *pSource, const char *pTarget, const char *pMessage) {
+void BnxBot::OnPrivmsg(const char *pSource, const char *pTarget, char *pMessage) {
 	IrcClient::OnPrivmsg(pSource, pTarget, pMessage);
 
 	if (!IsMe(pTarget))
-		m_clSeenList.Saw(IrcUser(pSource), pTarget);
+		m_clSeenList.Saw(IrcUser(pSource), pTarget, GetMessageTime());
 
 	ProcessFlood(pSource, pTarget, pMessage);
 
-	CtcpDecoder clDecoder(pMessage);
-	CtcpMessage message;
-
-	// Get first non-empty message
-	while (clDecoder.Decode(message) && 
-		(message.tagSize == 0 && message.dataSize == 0));
-
-	if (message.tagSize > 0) {
-		const char *pTag = (const char *)message.tag;
-		pMessage = (const char *)message.data;
+	char * const pTagged = CtcpFindTagged(pMessage);
 
-		if (!strcmp(pTag,"VERSION")) {
-			OnCtcpVersion(pSource, pTarget);
-		}
-		else if (!strcmp(pTag,"TIME")) {
-			OnCtcpTime(pSource, pTarget);
-		}
-		else if (!strcmp(pTag,"ACTION")) {
-			if (message.dataSize > 0)
-				OnCtcpAction(pSource, pTarget, pMessage);
-		}
-		else if (!strcmp(pTag,"PING")) {
-			if (message.dataSize > 0)
-				OnCtcpPing(pSource, pTarget, pMessage);
-		}
-	}
-	else {
-		// Don't use the decoded non-tagged data since it strips lone backslash
+	if (pTagged == NULL) {
+		// Plain text is used as is, decoding would strip lone backslashes
 
 		if (ProcessCommand(pSource, pTarget, pMessage))
 			return;
@@ -945,6 +1167,38 @@ void BnxBot::OnPrivmsg(const char *pSource, const char *pTarget, const char *pMe
 
 		// Finally, process the message text
 		ProcessMessage(pSource, pTarget, pMessage);
+		return;
+	}
+
+	// Nothing else reads the message past this point
+	CtcpDecoder clDecoder;
+	clDecoder.SetBuffer(pTagged);
+
+	CtcpMessage message;
+
+	// Get first non-empty message
+	while (clDecoder.Decode(message) && 
+		(message.tagSize == 0 && message.dataSize == 0));
+
+	if (message.tagSize == 0)
+		return;
+
+	const char *pTag = (const char *)message.tag;
+	const char *pData = (const char *)message.data;
+
+	if (!strcmp(pTag,"VERSION")) {
+		OnCtcpVersion(pSource, pTarget);
+	}
+	else if (!strcmp(pTag,"TIME")) {
+		OnCtcpTime(pSource, pTarget);
+	}
+	else if (!strcmp(pTag,"ACTION")) {
+		if (message.dataSize > 0)
+			OnCtcpAction(pSource, pTarget, pData);
+	}
+	else if (!strcmp(pTag,"PING")) {
+		if (message.dataSize > 0)
+			OnCtcpPing(pSource, pTarget, pData);
 	}
 }
 
@@ -961,27 +1215,31 @@ void BnxBot::OnJoin(const char *pSource, const char *pChannel) {
 
 	ChannelIterator channelItr = GetChannel(pChannel);
 
-	// What? Must be me on RFC2812
-	if (channelItr == ChannelEnd())
-		return;
-
 	IrcUser clUser(pSource);
 
+	// Must be me on RFC2812, RPL_NAMEREPLY follows
+	if (channelItr == ChannelEnd()) {
+		if (IsMe(clUser.GetNickname().c_str()))
+			JoinedChannel(pChannel);
+
+		return;
+	}
+
 	channelItr->AddMember(clUser);
-	m_clSeenList.Saw(clUser, pChannel);
+	m_clSeenList.Saw(clUser, pChannel, GetMessageTime());
 
 	if (channelItr->IsOperator()) {
 		BnxShitList::ConstIterator shitItr = m_clShitList.FindMatch(clUser);
 
 		if (shitItr != m_clShitList.End()) {
-			Send(AUTO, "MODE %s +b %s\r\n", pChannel, shitItr->GetHostmask().c_str());
+			Ban(AUTO, pChannel, shitItr->GetHostmask().str());
 			Send(AUTO, "KICK %s %s :because I don't like you\r\n", pChannel, 
 				clUser.GetNickname().c_str());
 			return;
 		}
 	}
 
-	if (channelItr->GetSize() == 2)
+	if (channelItr->IsSynced() && channelItr->GetSize() == 2)
 		Send(AUTO, "PRIVMSG %s :Hi!\r\n", pChannel);
 }
 
@@ -990,7 +1248,7 @@ void BnxBot::OnPart(const char *pSource, const char *pChannel, const char *pReas
 
 	IrcUser clUser(pSource);
 
-	if (IsMe(clUser.GetNickname())) {
+	if (IsMe(clUser.GetNickname().c_str())) {
 		DeleteChannel(pChannel);
 		return;
 	}
@@ -1001,7 +1259,7 @@ void BnxBot::OnPart(const char *pSource, const char *pChannel, const char *pReas
 	if (channelItr == ChannelEnd())
 		return;
 
-	channelItr->DeleteMember(clUser.GetNickname());
+	channelItr->DeleteMember(clUser.GetNickname().c_str());
 }
 
 void BnxBot::OnMode(const char *pSource, const char *pTarget, const char *pMode, const char *pParams[], unsigned int numParams) {
@@ -1021,44 +1279,46 @@ void BnxBot::OnMode(const char *pSource, const char *pTarget, const char *pMode,
 
 		const char *pModeString = pMode;
 
+		const bool bFromMe = IsMe(IrcUser(pSource).GetNickname().c_str());
+
 		bool bSetMode = true;
 
-		for ( ;*pMode != '\0'; ++pMode) {
-			switch (*pMode) {
-			case 'o':
-				if (IsMe(*pParams))
-					channelItr->SetOperator(bSetMode);
+		for ( ; *pMode != '\0'; ++pMode) {
+			const char mode = *pMode;
 
-				++pParams;
-				--numParams;
-				break;
-			case '-':
-				bSetMode = false;
-				break;
-			case '+':
-				bSetMode = true;
-				break;
-			default:
-				// Process all other modes
-				switch (clTraits.ClassifyChanMode(*pMode)) {
-				case IrcTraits::TYPE_A:
-				case IrcTraits::TYPE_B:
-					++pParams;
-					--numParams;
-					break;
-				case IrcTraits::TYPE_C:
-					if (bSetMode) {
-						++pParams;
-						--numParams;
-					}
-					break;
-				case IrcTraits::TYPE_D:
+			if (mode == '+' || mode == '-') {
+				bSetMode = (mode == '+');
+				continue;
+			}
+
+			const char *pParam = NULL;
+
+			if (clTraits.HasModeParam(mode, bSetMode)) {
+				// What?
+				if (numParams == 0)
 					break;
-				}
+
+				pParam = *pParams++;
+				--numParams;
+			}
+
+			if (pParam == NULL)
+				continue;
+
+			if (mode == 'o') {
+				if (IsMe(pParam))
+					channelItr->SetOperator(bSetMode);
+			}
+			else if (clTraits.ClassifyChanMode(mode) == IrcTraits::TYPE_A &&
+					(mode == 'b' || mode == clTraits.GetExcepts() || mode == clTraits.GetInvex())) {
+				if (bSetMode)
+					channelItr->AddListEntry(mode, pParam, bFromMe, GetMessageTime());
+				else
+					channelItr->DeleteListEntry(mode, pParam);
 			}
 		}
 
-		if (numParams != 0) {
+		if (*pMode != '\0' || numParams != 0) {
 			Log("Didn't process modes correctly: %s", pModeString);
 		}
 	}
@@ -1070,7 +1330,7 @@ void BnxBot::OnQuit(const char *pSource, const char *pReason) {
 	IrcUser clUser(pSource);
 
 	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i)
-		m_vCurrentChannels[i].DeleteMember(clUser.GetNickname());
+		m_vCurrentChannels[i].DeleteMember(clUser.GetNickname().c_str());
 }
 
 void BnxBot::OnCtcpAction(const char *pSource, const char *pTarget, const char *pMessage) {
@@ -1083,10 +1343,7 @@ void BnxBot::OnCtcpPing(const char *pSource, const char *pTarget, const char *pM
 	if (IsSquelched(clUser))
 		return;
 
-	CtcpEncoder clEncoder;
-	clEncoder.Encode(MakeCtcpMessage("PING", pMessage));
-
-	Send(AUTO, "NOTICE %s :%s\r\n", clUser.GetNickname().c_str(), clEncoder.GetRaw());
+	SendCtcpReply(clUser, "PING", pMessage);
 }
 
 void BnxBot::OnCtcpVersion(const char *pSource, const char *pTarget) {
@@ -1101,10 +1358,7 @@ void BnxBot::OnCtcpVersion(const char *pSource, const char *pTarget) {
 	//  finished executing.
 	std::string strVersion = GetVersionString();
 
-	CtcpEncoder clEncoder;
-	clEncoder.Encode(MakeCtcpMessage("VERSION", strVersion.c_str()));
-
-	Send(AUTO, "NOTICE %s :%s\r\n", clUser.GetNickname().c_str(), clEncoder.GetRaw());
+	SendCtcpReply(clUser, "VERSION", strVersion.c_str());
 }
 
 void BnxBot::OnCtcpTime(const char *pSource, const char *pTarget) {
@@ -1113,8 +1367,7 @@ void BnxBot::OnCtcpTime(const char *pSource, const char *pTarget) {
 	if (IsSquelched(clUser))
 		return;
 
-	time_t rawTime = 0;
-	time(&rawTime);
+	time_t rawTime = IrcClock::WallNow();
 
 	// XXX: Not thread-safe
 	struct tm *pLocalTime = localtime(&rawTime);
@@ -1122,10 +1375,7 @@ void BnxBot::OnCtcpTime(const char *pSource, const char *pTarget) {
 	char aBuff[128] = "";
 	strftime(aBuff, sizeof(aBuff), "%c", pLocalTime);
 
-	CtcpEncoder clEncoder;
-	clEncoder.Encode(MakeCtcpMessage("TIME", aBuff));
-
-	Send(AUTO, "NOTICE %s :%s\r\n", clUser.GetNickname().c_str(), clEncoder.GetRaw());
+	SendCtcpReply(clUser, "TIME", aBuff);
 }
 
 bool BnxBot::OnCommandLogin(const IrcUser &clUser, const std::string &strPassword) {
@@ -1170,7 +1420,7 @@ bool BnxBot::OnCommandChatter(UserSession &clSession) {
 	m_bChatter = true;
 
 	// The original BNX would ignore users indefinitely, here we'll clear the list on "chatter"
-	m_vSquelchedUsers.clear();
+	m_clSquelchList.Reset();
 
 	Send(AUTO, "PRIVMSG %s :Permission to speak freely, sir?\r\n", clUser.GetNickname().c_str());
 
@@ -1242,10 +1492,10 @@ bool BnxBot::OnCommandUserList(UserSession &clSession) {
 
 	for (entryItr = m_clAccessSystem.EntryBegin(); entryItr != m_clAccessSystem.EntryEnd(); ++entryItr) {
 		const IrcUser &clMask = entryItr->GetHostmask();
-		std::string strMask = clMask.GetHostmask();
+		const IrcStringView clMaskString = clMask.GetHostmask();
 		int iAccessLevel = entryItr->GetAccessLevel();
 
-		Send(AUTO, "PRIVMSG %s :%s %d\r\n", clUser.GetNickname().c_str(), strMask.c_str(), iAccessLevel);
+		Send(AUTO, "PRIVMSG %s :%s %d\r\n", clUser.GetNickname().c_str(), clMaskString.c_str(), iAccessLevel);
 	}
 
 	Send(AUTO, "PRIVMSG %s :End of Access List.\r\n", clUser.GetNickname().c_str());
@@ -1306,7 +1556,7 @@ bool BnxBot::OnCommandSquelch(UserSession &clSession, const std::string &strHost
 
 	const IrcUser &clUser = clSession.GetUser();
 
-	Squelch(IrcUser(strHostmask));
+	m_clSquelchList.Squelch(IrcUser(strHostmask));
 
 	Send(AUTO, "PRIVMSG %s :OK, ignoring...\r\n", clUser.GetNickname().c_str());
 
@@ -1319,7 +1569,7 @@ bool BnxBot::OnCommandUnsquelch(UserSession &clSession, const std::string &strHo
 
 	const IrcUser &clUser = clSession.GetUser();
 
-	Unsquelch(IrcUser(strHostmask));
+	m_clSquelchList.Unsquelch(IrcUser(strHostmask));
 
 	Send(AUTO, "PRIVMSG %s :OK, unignoring...\r\n", clUser.GetNickname().c_str());
 
@@ -1457,16 +1707,22 @@ bool BnxBot::OnCommandBan(UserSession &clSession, const std::string &strChannel,
 
 	if (!IrcIsHostmask(strHostmask.c_str())) {
 		// Nickname
+		if (!channelItr->IsSynced()) {
+			Send(AUTO, "PRIVMSG %s :I don't know who is in %s yet, try again in a moment.\r\n", 
+				clUser.GetNickname().c_str(), strChannel.c_str());
+			return true;
+		}
+
 		BnxChannel::ConstMemberIterator memberItr = channelItr->GetMember(strHostmask);
 
 		if (memberItr != channelItr->MemberEnd()) {
 			const IrcUser &clMember = memberItr->GetUser();
-			strKickNick = clMember.GetNickname();
+			strKickNick = clMember.GetNickname().str();
 			clBanMask.Set("*","*",clMember.GetHostname());
 		}
 	}
 
-	Send(AUTO, "MODE %s +b %s\r\n", strChannel.c_str(), clBanMask.GetHostmask().c_str());
+	Ban(AUTO, strChannel.c_str(), clBanMask.GetHostmask().str());
 
 	if (!strKickNick.empty()) {
 		Send(AUTO, "KICK %s %s :%s\r\n", strChannel.c_str(), strKickNick.c_str(), strReason.c_str());
@@ -1520,6 +1776,12 @@ bool BnxBot::OnCommandSplatterKick(UserSession &clSession, const std::string &st
 		return true;
 	}
 
+	if (!channelItr->IsSynced()) {
+		Send(AUTO, "PRIVMSG %s :I don't know who is in %s yet, try again in a moment.\r\n", 
+			clUser.GetNickname().c_str(), strChannel.c_str());
+		return true;
+	}
+
 	BnxChannel::ConstMemberIterator memberItr = channelItr->GetMember(strNickname);
 
 	if (memberItr == channelItr->MemberEnd()) {
@@ -1556,6 +1818,12 @@ bool BnxBot::OnCommandVoteBan(UserSession &clSession, const std::string &strChan
 	if (channelItr->IsVoteBanInProgress())
 		return false;
 
+	if (!channelItr->IsSynced()) {
+		Send(AUTO, "PRIVMSG %s :I don't know who is in %s yet, try again in a moment.\r\n", 
+			clUser.GetNickname().c_str(), strChannel.c_str());
+		return true;
+	}
+
 	// Apparently the original checks this here
 	if (IsMe(strNickname)) {
 		Send(AUTO, "PRIVMSG %s :Only a MORON thinks I would try to ban MYSELF!\r\n", 
@@ -1661,7 +1929,7 @@ bool BnxBot::OnCommandWho(UserSession &clSession, const std::string &strChannel)
 		if (!strOutput.empty())
 			strOutput += ", ";
 
-		strOutput += memberItr->GetUser().GetNickname();
+		strOutput += memberItr->GetNickname();
 
 		if (++uiCount == 5) {
 			Send(AUTO, "PRIVMSG %s :%s\r\n", 
@@ -1680,19 +1948,7 @@ bool BnxBot::OnCommandWho(UserSession &clSession, const std::string &strChannel)
 	return true;
 }
 
-bool BnxBot::OnCommandSeen(UserSession &clSession, const std::string &strNickname) {
-	const IrcUser &clUser = clSession.GetUser();
-
-	BnxSeenList::Iterator itr = m_clSeenList.Find(strNickname);
-
-	if (itr == m_clSeenList.End()) {
-		Send(AUTO, "PRIVMSG %s :Haven't seen %s in any channel.\r\n",
-			clUser.GetNickname().c_str(), strNickname.c_str());
-		return true;
-	}
-
-	const BnxSeenList::SeenInfo &clSeenInfo = itr->second;
-
+void BnxBot::SendSeenInfo(const char *pTarget, const BnxSeenList::SeenInfo &clSeenInfo) {
 	time_t rawTime = clSeenInfo.GetTimestamp();
 
 	// XXX: Not thread-safe
@@ -1702,8 +1958,36 @@ bool BnxBot::OnCommandSeen(UserSession &clSession, const std::string &strNicknam
 	strftime(aFormattedTime, sizeof(aFormattedTime), "%c", pLocalTime);
 
 	Send(AUTO, "PRIVMSG %s :Last saw %s in channel %s on %s.\r\n",
-		clUser.GetNickname().c_str(), clSeenInfo.GetUser().GetHostmask().c_str(),
+		pTarget, clSeenInfo.GetUser().GetHostmask().c_str(),
 		clSeenInfo.GetChannel().c_str(), aFormattedTime);
+}
+
+bool BnxBot::OnCommandSeen(UserSession &clSession, const std::string &strNickname) {
+	const IrcUser &clUser = clSession.GetUser();
+
+	if (strNickname.find_first_of("*?!@") != std::string::npos) {
+		// Wildcard searches run a slice at a time so large lists don't stall the bot
+		m_dqSeenSearches.push_back(std::make_pair(clUser.GetNickname().str(), BnxSeenList::Query(strNickname)));
+
+		if (m_dqSeenSearches.size() == 1) {
+			struct timeval tv;
+			tv.tv_sec = tv.tv_usec = 0;
+
+			m_clSeenSearchTimer.Add(&tv);
+		}
+
+		return true;
+	}
+
+	BnxSeenList::SeenInfo clSeenInfo;
+
+	if (!m_clSeenList.Find(strNickname, clSeenInfo)) {
+		Send(AUTO, "PRIVMSG %s :Haven't seen %s in any channel.\r\n",
+			clUser.GetNickname().c_str(), strNickname.c_str());
+		return true;
+	}
+
+	SendSeenInfo(clUser.GetNickname().c_str(), clSeenInfo);
 
 	return true;
 }
@@ -1718,16 +2002,13 @@ bool BnxBot::OnCommandLastSeen(UserSession &clSession, const std::string &strCha
 	Send(AUTO, "PRIVMSG %s :Users last seen in the past %d days in channel %s:\r\n",
 		clUser.GetNickname().c_str(), iDays, strChannel.c_str());
 
-	BnxSeenList::Iterator itr;
+	std::vector<BnxSeenList::SeenInfo> vSeenInfo;
 
-	int iCount = 0;
-	for (itr = m_clSeenList.Begin(); itr != m_clSeenList.End(); ++itr) {
-		const BnxSeenList::SeenInfo &clSeenInfo = itr->second;
+	m_clSeenList.FindRecent(strChannel, IrcClock::WallNow() - iMaxTime, vSeenInfo);
 
-		if (IrcStrCaseCmp(clSeenInfo.GetChannel().c_str(), strChannel.c_str()) != 0 ||
-			time(NULL) - clSeenInfo.GetTimestamp() >= iMaxTime) {
-			continue;
-		}
+	int iCount = 0;
+	for (size_t i = 0; i < vSeenInfo.size(); ++i) {
+		const BnxSeenList::SeenInfo &clSeenInfo = vSeenInfo[i];
 
 		++iCount;
 
@@ -1768,7 +2049,61 @@ void BnxBot::AddChannel(const char *pChannel) {
 
 	IrcCaseMapping eCaseMapping = GetIrcTraits().GetCaseMapping();
 
-	m_vCurrentChannels.push_back(BnxChannel(pChannel, eCaseMapping));
+	m_vCurrentChannels.push_back(BnxChannel(pChannel, eCaseMapping, m_clHostnames));
+}
+
+void BnxBot::JoinedChannel(const char *pChannel) {
+	AddChannel(pChannel);
+
+	// Now really collect useful information (paced with the other channels)
+	m_clChannelSync.QueueQuery(pChannel);
+	SyncChannels();
+}
+
+IrcUser BnxBot::ParseName(const std::string &strName, bool *pOperator) const {
+	const IrcTraits &clTraits = GetIrcTraits();
+
+	// All of the member's prefixes with multi-prefix, otherwise only the highest
+	size_t p = 0;
+	for ( ; p < strName.size() && clTraits.GetModeByPrefix(strName[p]) != '\0'; ++p) {
+		if (pOperator != NULL && clTraits.GetModeByPrefix(strName[p]) == 'o')
+			*pOperator = true;
+	}
+
+	// Just the nickname unless userhost-in-names is enabled
+	return IrcUser(strName.substr(p));
+}
+
+void BnxBot::SyncChannels() {
+	std::string strLine;
+
+	while (m_clChannelSync.PopJoinLine(strLine))
+		Send(AUTO, "%s\r\n", strLine.c_str());
+
+	std::string strChannel;
+
+	while (m_clChannelSync.PopQuery(strChannel)) {
+		const char * const pChannel = strChannel.c_str();
+		const IrcTraits &clTraits = GetIrcTraits();
+
+		// With userhost-in-names members come from RPL_NAMEREPLY
+		if (!HasCapability(CAP_USERHOST_IN_NAMES)) {
+			// Only the fields we use, tagged so that the replies can be told apart
+			if (clTraits.GetWhoX())
+				Send(AUTO, "WHO %s %%tcuhnf,%d\r\n", pChannel, (int)WHOX_MEMBERS_TOKEN);
+			else
+				Send(AUTO, "WHO %s\r\n", pChannel);
+		}
+
+		if (clTraits.GetExcepts() != '\0')
+			Send(AUTO, "MODE %s %c\r\n", pChannel, clTraits.GetExcepts());
+
+		if (clTraits.GetInvex() != '\0')
+			Send(AUTO, "MODE %s %c\r\n", pChannel, clTraits.GetInvex());
+
+		// Last since anyone may see the ban list, RPL_ENDOFBANLIST finishes the channel
+		Send(AUTO, "MODE %s b\r\n", pChannel);
+	}
 }
 
 void BnxBot::DeleteChannel(const char *pChannel) {
@@ -1779,21 +2114,48 @@ void BnxBot::DeleteChannel(const char *pChannel) {
 }
 
 BnxBot::ChannelIterator BnxBot::DeleteChannel(ChannelIterator channelItr) {
-	return m_vCurrentChannels.erase(channelItr);
+	m_clChannelSync.Cancel(channelItr->GetName().c_str());
+
+	channelItr = m_vCurrentChannels.erase(channelItr);
+
+	// Frees a query slot for the others
+	SyncChannels();
+
+	return channelItr;
 }
 
-void BnxBot::Squelch(const IrcUser &clUser) {
-	if (!IsSquelched(clUser))
-		m_vSquelchedUsers.push_back(clUser);
+void BnxBot::SendCtcpReply(const IrcUser &clUser, const char *pTag, const char *pData) {
+	CtcpEncoder clEncoder;
+
+	if (!clEncoder.Encode(MakeCtcpMessage(pTag, pData)))
+		return;
+
+	std::string strLine = "NOTICE ";
+	strLine.append(clUser.GetNickname().data(), clUser.GetNickname().size());
+	strLine += " :";
+	strLine += clEncoder.GetRaw();
+	strLine += "\r\n";
+
+	// Replies to CTCP floods are dropped here rather than piling up in the send queue
+	if (m_clCtcpResponder.Queue(clUser, strLine))
+		FlushCtcpReplies();
 }
 
-void BnxBot::Unsquelch(const IrcUser &clUser) {
-	std::vector<IrcUser>::iterator itr;
+void BnxBot::FlushCtcpReplies() {
+	std::string strLine;
 
-	itr = std::find(m_vSquelchedUsers.begin(), m_vSquelchedUsers.end(), clUser);
+	while (m_clCtcpResponder.Pop(strLine))
+		Send(AUTO, "%s", strLine.c_str());
 
-	if (itr != m_vSquelchedUsers.end())
-		m_vSquelchedUsers.erase(itr);
+	if (m_clCtcpResponder.HasPending()) {
+		const unsigned int waitTime = m_clCtcpResponder.GetWaitTime();
+
+		struct timeval tv;
+		tv.tv_sec = waitTime / 1000;
+		tv.tv_usec = (waitTime % 1000) * 1000;
+
+		m_clCtcpTimer.Add(&tv);
+	}
 }
 
 void BnxBot::OnConnectTimer(evutil_socket_t fd, short what) {
@@ -1815,9 +2177,11 @@ void BnxBot::OnFloodTimer(evutil_socket_t fd, short what) {
 
 	for (size_t i = 0; i < vFlooders.size(); ++i) {
 		Log("Ignoring %s for flooding", vFlooders[i].GetHostmask().c_str());
-		Squelch(IrcUser("*","*",vFlooders[i].GetHostname()));
+		m_clSquelchList.Squelch(IrcUser("*","*",vFlooders[i].GetHostname()), m_iSquelchTime);
 	}
 
+	m_clSquelchList.ExpireEntries();
+
 	// Detect floods in channels
 	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i) {
 		BnxChannel &clChannel = m_vCurrentChannels[i];
@@ -1837,7 +2201,7 @@ void BnxBot::OnFloodTimer(evutil_socket_t fd, short what) {
 		for (size_t j = 0; j < vFlooders.size(); ++j) {
 			const IrcUser &clUser = vFlooders[j];
 
-			BnxChannel::WarningIterator warningItr = clChannel.Warn(clUser.GetHostname());
+			BnxChannel::WarningIterator warningItr = clChannel.Warn(clUser.GetHostname().str());
 
 			switch (warningItr->GetCount()) {
 			case 0:
@@ -1858,8 +2222,7 @@ void BnxBot::OnFloodTimer(evutil_socket_t fd, short what) {
 				Log("Banning %s from %s for flooding", 
 					clUser.GetHostmask().c_str(), clChannel.GetName().c_str());
 
-				Send(AUTO, "MODE %s +b %s\r\n", 
-					clChannel.GetName().c_str(), clUser.GetBanMask().c_str());
+				Ban(AUTO, clChannel.GetName().c_str(), clUser.GetBanMask());
 				Send(AUTO, "KICK %s %s :for flooding\r\n", 
 					clChannel.GetName().c_str(), clUser.GetNickname().c_str());
 
@@ -1898,12 +2261,33 @@ void BnxBot::OnChannelsTimer(evutil_socket_t fd, short what) {
 		ChannelIterator channelItr = GetChannel(m_vHomeChannels[i].c_str());
 
 		if (channelItr == ChannelEnd())
-			Send(AUTO, "JOIN %s\r\n", m_vHomeChannels[i].c_str());
+			m_clChannelSync.QueueJoin(m_vHomeChannels[i]);
+	}
+
+	// Bans the server never echoed nor refused
+	for (size_t i = 0; i < m_vCurrentChannels.size(); ++i)
+		m_vCurrentChannels[i].DeletePendingListEntries(IrcClock::WallNow() - BnxChannel::PENDING_LIST_TIMEOUT);
+
+	std::vector<std::string> vGivenUp;
+
+	if (m_clChannelSync.ExpireQueries(vGivenUp) > 0)
+		Log("Gave up waiting on channel queries, now querying %lu channel(s) at a time", (unsigned long)m_clChannelSync.GetWindow());
+
+	// Go with whatever arrived rather than refusing channel commands until we leave
+	for (size_t i = 0; i < vGivenUp.size(); ++i) {
+		ChannelIterator channelItr = GetChannel(vGivenUp[i].c_str());
+
+		if (channelItr != ChannelEnd() && !channelItr->IsSynced()) {
+			Log("No complete member list for %s, using what is known.", vGivenUp[i].c_str());
+			channelItr->SetSynced(true);
+		}
 	}
+
+	SyncChannels();
 }
 
 void BnxBot::OnAntiIdleTimer(evutil_socket_t fd, short what) {
-	if (time(NULL)-GetLastRecvTime() > 30)
+	if (IrcClock::Now()-GetLastRecvTime() > 30)
 		Send(AUTO, "PING :%s\r\n", GetCurrentServer().c_str());
 }
 
@@ -1914,3 +2298,40 @@ void BnxBot::OnSeenListTimer(evutil_socket_t fd, short what) {
 	m_clSeenList.Save();
 }
 
+void BnxBot::OnSeenSearchTimer(evutil_socket_t fd, short what) {
+	if (m_dqSeenSearches.empty())
+		return;
+
+	const std::string &strTarget = m_dqSeenSearches.front().first;
+	BnxSeenList::Query &clQuery = m_dqSeenSearches.front().second;
+
+	if (m_clSeenList.Search(clQuery)) {
+		const std::vector<BnxSeenList::SeenInfo> &vResults = clQuery.GetResults();
+
+		if (vResults.empty()) {
+			Send(AUTO, "PRIVMSG %s :Haven't seen %s in any channel.\r\n",
+				strTarget.c_str(), clQuery.GetPattern().c_str());
+		}
+
+		for (size_t i = 0; i < vResults.size(); ++i)
+			SendSeenInfo(strTarget.c_str(), vResults[i]);
+
+		if (clQuery.IsTruncated()) {
+			Send(AUTO, "PRIVMSG %s :Too many matches for %s, showing the first %d.\r\n",
+				strTarget.c_str(), clQuery.GetPattern().c_str(), (int)vResults.size());
+		}
+
+		m_dqSeenSearches.pop_front();
+	}
+
+	if (!m_dqSeenSearches.empty()) {
+		struct timeval tv;
+		tv.tv_sec = tv.tv_usec = 0;
+
+		m_clSeenSearchTimer.Add(&tv);
+	}
+}
+
+void BnxBot::OnCtcpTimer(evutil_socket_t fd, short what) {
+	FlushCtcpReplies();
+}
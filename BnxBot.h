@@ -26,16 +26,20 @@
 #ifndef BNXBOT_H
 #define BNXBOT_H
 
+#include <deque>
 #include <string>
 #include <utility>
 #include <vector>
-#include "BnxResponseEngine.h"
+#include "BnxResponseEngineCache.h"
 #include "BnxAccessSystem.h"
 #include "BnxShitList.h"
+#include "BnxSquelchList.h"
 #include "BnxChannel.h"
 #include "BnxFloodDetector.h"
 #include "BnxSeenList.h"
-#include "IrcEvent.h"
+#include "BnxCtcpResponder.h"
+#include "BnxChannelSync.h"
+#include "IrcTimerWheel.h"
 #include "IrcClient.h"
 #include "IrcUser.h"
 
@@ -53,16 +57,23 @@ public:
 	void SetProfileName(const std::string &strProfileName);
 	const std::string & GetProfileName() const;
 
+	const BnxCtcpResponder & GetCtcpResponder() const;
+
 	void SetServerAndPort(const std::string &strServer, const std::string &strPort = "6667");
 	void SetNickServAndPassword(const std::string &strNickServ, const std::string &strPassword);
 	void SetHomeChannels(const std::string &strChannels);
 	void AddHomeChannels(const std::string &strChannels);
 	void DeleteHomeChannels(const std::string &strChannels);
 	bool LoadResponseRules(const std::string &strFileName);
+
+	// Uses rules compiled elsewhere (e.g. shared with other bots)
+	void SetResponseEngine(const BnxResponseEngineCache::EnginePtr &pResponseEngine);
 	bool LoadAccessList(const std::string &strFilename);
 	bool LoadShitList(const std::string &strFilename);
 	bool LoadSeenList(const std::string &strSeenList);
 	void SetLogFile(const std::string &strLogFile);
+	void SetSquelchTime(int iSquelchTime);
+	void SetSquelchListSize(size_t maxSize);
 
 	void StartUp();
 	void Shutdown();
@@ -85,6 +96,9 @@ protected:
 	bool IsSquelched(const IrcUser &clUser);
 	void SplatterKick(const char *pChannel, const IrcUser &clUser);
 
+	// Skips masks that are already banned, a full ban list loses its oldest ban set by the bot
+	void Ban(WhenType eWhen, const char *pChannel, const std::string &strMask);
+
 	// IRC events
 	virtual void OnConnect();
 	virtual void OnDisconnect();
@@ -92,12 +106,14 @@ protected:
 	virtual void OnNumeric(const char *pSource, int numeric, const char *pParams[], unsigned int numParams);
 	virtual void OnNick(const char *pSource, const char *pNewNick);
 	virtual void OnKick(const char *pSource, const char *pChannel, const char *pUser, const char *pReason);
-	virtual void OnPrivmsg(const char *pSource, const char *pTarget, const char *pMessage);
+	virtual void OnPrivmsg(const char *pSource, const char *pTarget, char *pMessage);
 	virtual void OnNotice(const char *pSource, const char *pTarget, const char *pMessage);
 	virtual void OnJoin(const char *pSource, const char *pChannel);
 	virtual void OnPart(const char *pSource, const char *pChannel, const char *pReason);
 	virtual void OnMode(const char *pSource, const char *pTarget, const char *pMode, const char *pParams[], unsigned int numParams);
 	virtual void OnQuit(const char *pSource, const char *pReason);
+	virtual void OnChghost(const char *pSource, const char *pNewUsername, const char *pNewHostname);
+	virtual void OnAway(const char *pSource, const char *pMessage);
 
 	// CTCP events
 	virtual void OnCtcpAction(const char *pSource, const char *pTarget, const char *pMessage);
@@ -146,16 +162,8 @@ protected:
 	virtual bool OnCommandReconnect(UserSession &clSession);
 
 private:
-	struct MaskMatches {
-		MaskMatches(const IrcUser &clUser_)
-		: clUser(clUser_) { }
-
-		bool operator()(const IrcUser &clMask) const {
-			return clMask.Matches(clUser);
-		}
-
-		const IrcUser &clUser;
-	};
+	// WHOX query token for channel member lists
+	enum { WHOX_MEMBERS_TOKEN = 152 };
 
 	struct StringEquals {
 		StringEquals(const std::string &strString1_)
@@ -171,25 +179,51 @@ private:
 	std::string m_strProfileName, m_strServer, m_strPort, m_strNickServ, 
 			m_strNickServPassword, m_strLogFile;
 
-	IrcEvent m_clConnectTimer, m_clFloodTimer, m_clVoteBanTimer,
-		m_clChannelsTimer, m_clAntiIdleTimer, m_clSeenListTimer;
+	IrcTimer m_clConnectTimer, m_clFloodTimer, m_clVoteBanTimer,
+		m_clChannelsTimer, m_clAntiIdleTimer, m_clSeenListTimer, m_clSeenSearchTimer, m_clCtcpTimer;
 
 	bool m_bChatter;
 
+	// Seconds that automatic squelches last
+	int m_iSquelchTime;
+
 	std::vector<std::string> m_vHomeChannels;
-	std::vector<IrcUser> m_vSquelchedUsers;
+
+	// Hostnames shared by the channels, flood detectors, squelch list and seen list (declared before them)
+	IrcStringPool m_clHostnames;
+
 	std::vector<BnxChannel> m_vCurrentChannels;
-	BnxResponseEngine m_clResponseEngine;
+	BnxResponseEngineCache::EnginePtr m_pResponseEngine;
 	BnxAccessSystem m_clAccessSystem;
 	BnxShitList m_clShitList;
+	BnxSquelchList m_clSquelchList;
 	BnxFloodDetector m_clFloodDetector;
 	BnxSeenList m_clSeenList;
+	BnxCtcpResponder m_clCtcpResponder;
+	BnxChannelSync m_clChannelSync;
+
+	// Pending wildcard seen searches and who asked for them
+	std::deque<std::pair<std::string, BnxSeenList::Query> > m_dqSeenSearches;
 
 	void AddChannel(const char *pChannel);
+
+	// Sets up a channel we just joined and queries its state
+	void JoinedChannel(const char *pChannel);
+
+	// Strips the status prefixes from a RPL_NAMEREPLY name
+	IrcUser ParseName(const std::string &strName, bool *pOperator = NULL) const;
+
+	// Sends the JOINs and channel queries the channel sync allows right now
+	void SyncChannels();
+
 	void DeleteChannel(const char *pChannel);
 	ChannelIterator DeleteChannel(ChannelIterator channelItr);
-	void Squelch(const IrcUser &clUser);
-	void Unsquelch(const IrcUser &clser);
+	void SendSeenInfo(const char *pTarget, const BnxSeenList::SeenInfo &clSeenInfo);
+
+	// The list mode an RPL_BANLIST style numeric is about
+	char GetListMode(int numeric) const;
+	void SendCtcpReply(const IrcUser &clUser, const char *pTag, const char *pData);
+	void FlushCtcpReplies();
 
 	void OnConnectTimer(evutil_socket_t fd, short what);
 	void OnFloodTimer(evutil_socket_t fd, short what);
@@ -197,6 +231,8 @@ private:
 	void OnChannelsTimer(evutil_socket_t fd, short what);
 	void OnAntiIdleTimer(evutil_socket_t fd, short what);
 	void OnSeenListTimer(evutil_socket_t fd, short what);
+	void OnSeenSearchTimer(evutil_socket_t fd, short what);
+	void OnCtcpTimer(evutil_socket_t fd, short what);
 };
 
 #endif // !BNXBOT_H
@@ -29,61 +29,85 @@
 #include <sstream>
 #include "BnxChannel.h"
 
+namespace {
+
+// Lists that were never seen
+const std::vector<BnxChannel::ListEntry> s_vNoEntries;
+
+} // end namespace
+
 void BnxChannel::AddMember(const IrcUser &clUser) {
-	if (GetMember(clUser.GetNickname()) != MemberEnd())
+	if (GetMember(clUser.GetNickname().c_str()) != MemberEnd())
 		return;
 
-	m_vMembers.push_back(Member(clUser));
+	m_vMembers.push_back(Member(clUser, m_eCaseMapping, *m_pHostnames));
 }
 
-BnxChannel::MemberIterator BnxChannel::GetMember(const std::string &strNickname) {
+BnxChannel::MemberIterator BnxChannel::GetMember(const char *pNickname) {
 	MemberIterator memberItr;
 
+	// Folding is idempotent, so this is the hash of the folded nickname like IrcKey's
+	const unsigned int hash = IrcStrCaseHash(pNickname, m_eCaseMapping);
+
 	for (memberItr = MemberBegin(); memberItr != MemberEnd(); ++memberItr) {
-		const IrcUser &clUser = memberItr->GetUser();
+		const IrcKey &clKey = memberItr->GetKey();
 
-		if (!IrcStrCaseCmp(strNickname.c_str(), clUser.GetNickname().c_str(), m_eCaseMapping))
+		if (clKey.GetHash() == hash && !IrcStrCaseCmp(clKey.GetFolded().c_str(), pNickname, m_eCaseMapping))
 			return memberItr;
 	}
 
 	return MemberEnd();
 }
 
-BnxChannel::ConstMemberIterator BnxChannel::GetMember(const std::string &strNickname) const {
+BnxChannel::ConstMemberIterator BnxChannel::GetMember(const char *pNickname) const {
 	ConstMemberIterator memberItr;
 
+	const unsigned int hash = IrcStrCaseHash(pNickname, m_eCaseMapping);
+
 	for (memberItr = MemberBegin(); memberItr != MemberEnd(); ++memberItr) {
-		const IrcUser &clUser = memberItr->GetUser();
+		const IrcKey &clKey = memberItr->GetKey();
 
-		if (!IrcStrCaseCmp(strNickname.c_str(), clUser.GetNickname().c_str(), m_eCaseMapping))
+		if (clKey.GetHash() == hash && !IrcStrCaseCmp(clKey.GetFolded().c_str(), pNickname, m_eCaseMapping))
 			return memberItr;
 	}
 
 	return MemberEnd();
 }
 
-void BnxChannel::DeleteMember(const std::string &strNickname) {
-	MemberIterator memberItr = GetMember(strNickname);
+void BnxChannel::DeleteMember(const char *pNickname) {
+	MemberIterator memberItr = GetMember(pNickname);
 
 	if (memberItr != MemberEnd())
 		DeleteMember(memberItr);
 }
 
-void BnxChannel::UpdateMember(const std::string &strNick, const std::string &strNewNick) {
-	MemberIterator memberItr = GetMember(strNick);
+void BnxChannel::UpdateMember(const char *pNick, const std::string &strNewNick) {
+	MemberIterator memberItr = GetMember(pNick);
 
 	if (memberItr != MemberEnd())
-		memberItr->GetUser().SetNickname(strNewNick);
+		memberItr->SetNickname(strNewNick);
 
-	if (IsVoteBanInProgress() && !IrcStrCaseCmp(m_clVoteBanMask.GetNickname().c_str(), strNick.c_str(), m_eCaseMapping))
+	if (IsVoteBanInProgress() && !IrcStrCaseCmp(m_clVoteBanMask.GetNickname().c_str(), pNick, m_eCaseMapping))
 		m_clVoteBanMask.SetNickname(strNewNick);
 }
 
+void BnxChannel::UpdateMemberHost(const char *pNick, const std::string &strNewUsername, const std::string &strNewHostname) {
+	MemberIterator memberItr = GetMember(pNick);
+
+	if (memberItr != MemberEnd())
+		memberItr->SetUserHost(*m_pHostnames, strNewUsername, strNewHostname);
+
+	if (IsVoteBanInProgress() && !IrcStrCaseCmp(m_clVoteBanMask.GetNickname().c_str(), pNick, m_eCaseMapping)) {
+		m_clVoteBanMask.SetUsername(strNewUsername);
+		m_clVoteBanMask.SetHostname(strNewHostname);
+	}
+}
+
 BnxChannel::WarningIterator BnxChannel::Warn(const std::string &strHostname) {
 	WarningIterator warningItr = GetWarningEntry(strHostname);
 
 	if (warningItr == WarningEnd()) 
-		warningItr = m_vWarnings.insert(m_vWarnings.end(), WarningEntry(strHostname));
+		warningItr = m_vWarnings.insert(m_vWarnings.end(), WarningEntry(*m_pHostnames, strHostname));
 
 	warningItr->Warn();
 
@@ -109,6 +133,192 @@ void BnxChannel::ExpireWarningEntries() {
 	}
 }
 
+bool BnxChannel::AddListEntry(char mode, const std::string &strMask, bool bMine, time_t timeStamp, bool bPending) {
+	ModeList *pList = FindModeList(mode);
+
+	if (pList != NULL) {
+		const IrcKey clMask(strMask, m_eCaseMapping);
+
+		for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+			if (pList->vEntries[i].GetKey() == clMask) {
+				if (!bPending)
+					pList->vEntries[i].Confirm();
+
+				return false;
+			}
+		}
+	}
+
+	if (pList == NULL) {
+		m_vModeLists.push_back(ModeList());
+		pList = &m_vModeLists.back();
+		pList->mode = mode;
+		pList->bSynced = false;
+	}
+
+	pList->vEntries.push_back(ListEntry(strMask, m_eCaseMapping, bMine, timeStamp, bPending));
+
+	return true;
+}
+
+bool BnxChannel::DeletePendingListEntry(char mode, const std::string &strMask) {
+	ModeList * const pList = FindModeList(mode);
+
+	if (pList == NULL)
+		return false;
+
+	const IrcKey clMask(strMask, m_eCaseMapping);
+
+	for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+		if (pList->vEntries[i].GetKey() == clMask) {
+			if (!pList->vEntries[i].IsPending())
+				return false;
+
+			pList->vEntries.erase(pList->vEntries.begin() + i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t BnxChannel::DeletePendingListEntries(time_t timeStamp) {
+	size_t numDeleted = 0;
+
+	for (size_t i = 0; i < m_vModeLists.size(); ++i) {
+		std::vector<ListEntry> &vEntries = m_vModeLists[i].vEntries;
+
+		size_t j = 0;
+
+		while (j < vEntries.size()) {
+			if (vEntries[j].IsPending() && vEntries[j].GetTimeStamp() <= timeStamp) {
+				vEntries.erase(vEntries.begin() + j);
+				++numDeleted;
+				continue;
+			}
+
+			// An echoed removal deletes the entry, so one still here wasn't carried out
+			if (vEntries[j].IsRemoving() && vEntries[j].GetRemoveTime() <= timeStamp) {
+				vEntries[j].Restore();
+				++numDeleted;
+			}
+
+			++j;
+		}
+	}
+
+	return numDeleted;
+}
+
+bool BnxChannel::DeleteListEntry(char mode, const std::string &strMask) {
+	ModeList * const pList = FindModeList(mode);
+
+	if (pList == NULL)
+		return false;
+
+	const IrcKey clMask(strMask, m_eCaseMapping);
+
+	for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+		if (pList->vEntries[i].GetKey() == clMask) {
+			pList->vEntries.erase(pList->vEntries.begin() + i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool BnxChannel::SetListEntryRemoving(char mode, const std::string &strMask, time_t timeStamp) {
+	ModeList * const pList = FindModeList(mode);
+
+	if (pList == NULL)
+		return false;
+
+	const IrcKey clMask(strMask, m_eCaseMapping);
+
+	for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+		if (pList->vEntries[i].GetKey() == clMask) {
+			pList->vEntries[i].SetRemoving(timeStamp);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool BnxChannel::HasListEntry(char mode, const std::string &strMask) const {
+	const ModeList * const pList = FindModeList(mode);
+
+	if (pList == NULL)
+		return false;
+
+	const IrcKey clMask(strMask, m_eCaseMapping);
+
+	for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+		if (pList->vEntries[i].GetKey() == clMask)
+			return true;
+	}
+
+	return false;
+}
+
+size_t BnxChannel::GetListSize(char mode) const {
+	const ModeList * const pList = FindModeList(mode);
+
+	if (pList == NULL)
+		return 0;
+
+	size_t listSize = 0;
+
+	for (size_t i = 0; i < pList->vEntries.size(); ++i) {
+		if (!pList->vEntries[i].IsRemoving())
+			++listSize;
+	}
+
+	return listSize;
+}
+
+BnxChannel::ConstListIterator BnxChannel::ListBegin(char mode) const {
+	const ModeList * const pList = FindModeList(mode);
+
+	return pList != NULL ? pList->vEntries.begin() : s_vNoEntries.begin();
+}
+
+BnxChannel::ConstListIterator BnxChannel::ListEnd(char mode) const {
+	const ModeList * const pList = FindModeList(mode);
+
+	return pList != NULL ? pList->vEntries.end() : s_vNoEntries.end();
+}
+
+BnxChannel::ConstListIterator BnxChannel::GetOldestOwnListEntry(char mode) const {
+	ConstListIterator oldestItr = ListEnd(mode);
+
+	for (ConstListIterator itr = ListBegin(mode); itr != ListEnd(mode); ++itr) {
+		if (itr->IsMine() && !itr->IsRemoving() && (oldestItr == ListEnd(mode) || itr->GetTimeStamp() < oldestItr->GetTimeStamp()))
+			oldestItr = itr;
+	}
+
+	return oldestItr;
+}
+
+bool BnxChannel::IsListSynced(char mode) const {
+	const ModeList * const pList = FindModeList(mode);
+
+	return pList != NULL && pList->bSynced;
+}
+
+void BnxChannel::SetListSynced(char mode) {
+	ModeList *pList = FindModeList(mode);
+
+	if (pList == NULL) {
+		m_vModeLists.push_back(ModeList());
+		pList = &m_vModeLists.back();
+		pList->mode = mode;
+	}
+
+	pList->bSynced = true;
+}
+
 void BnxChannel::ResetVoteBan() {
 	m_bVoteBan = false;
 	m_clVoteBanMask.Reset();
@@ -120,12 +330,14 @@ void BnxChannel::ResetVoteBan() {
 }
 
 void BnxChannel::Reset() {
-	m_strName.clear();
 	m_eCaseMapping = RFC1459;
+	m_clName.Set(std::string(), m_eCaseMapping);
 	m_vMembers.clear();
 	m_vWarnings.clear();
 	m_bIsOperator = false;
+	m_bSynced = false;
 	m_clFloodDetector.Reset();
+	m_vModeLists.clear();
 
 	ResetVoteBan();
 }
@@ -135,11 +347,11 @@ void BnxChannel::VoteBan(const IrcUser &clUser) {
 
 	m_bVoteBan = true;
 	m_clVoteBanMask = clUser;
-	m_voteBanTime = time(NULL);
+	m_voteBanTime = IrcClock::Now();
 }
 
-void BnxChannel::VoteYay(const std::string &strNickname) {
-	MemberIterator memberItr = GetMember(strNickname);
+void BnxChannel::VoteYay(const char *pNickname) {
+	MemberIterator memberItr = GetMember(pNickname);
 
 	// Only allow those members who were present prior to the voteban
 	if (memberItr == MemberEnd() || memberItr->GetTimeStamp() > m_voteBanTime)
@@ -152,8 +364,8 @@ void BnxChannel::VoteYay(const std::string &strNickname) {
 	m_iVoteCount += memberItr->GetVote() - iOldVote;
 }
 
-void BnxChannel::VoteNay(const std::string &strNickname) {
-	MemberIterator memberItr = GetMember(strNickname);
+void BnxChannel::VoteNay(const char *pNickname) {
+	MemberIterator memberItr = GetMember(pNickname);
 
 	// Only allow those members who were present prior to the voteban
 	if (memberItr == MemberEnd() || memberItr->GetTimeStamp() > m_voteBanTime)
@@ -166,3 +378,20 @@ void BnxChannel::VoteNay(const std::string &strNickname) {
 	m_iVoteCount += memberItr->GetVote() - iOldVote;
 }
 
+BnxChannel::ModeList * BnxChannel::FindModeList(char mode) {
+	for (size_t i = 0; i < m_vModeLists.size(); ++i) {
+		if (m_vModeLists[i].mode == mode)
+			return &m_vModeLists[i];
+	}
+
+	return NULL;
+}
+
+const BnxChannel::ModeList * BnxChannel::FindModeList(char mode) const {
+	for (size_t i = 0; i < m_vModeLists.size(); ++i) {
+		if (m_vModeLists[i].mode == mode)
+			return &m_vModeLists[i];
+	}
+
+	return NULL;
+}
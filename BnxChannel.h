@@ -26,36 +26,65 @@
 #ifndef BNXCHANNEL_H
 #define BNXCHANNEL_H
 
+#include <algorithm>
 #include <ctime>
 #include <string>
 #include <vector>
 #include "BnxFloodDetector.h"
 #include "IrcString.h"
+#include "IrcKey.h"
+#include "IrcClock.h"
+#include "IrcStringPool.h"
 #include "IrcUser.h"
 
 // Special channel for BnxBot and its functionality
 
 class BnxChannel {
 public:
-	enum { VOTEBAN_TIMEOUT = 30, WARNING_TIMEOUT = 600 };
+	enum { VOTEBAN_TIMEOUT = 30, WARNING_TIMEOUT = 600, PENDING_LIST_TIMEOUT = 120 };
 
 	class Member {
 	public:
-		Member(const IrcUser &clUser) {
+		// The hostname is interned in clHostnames
+		Member(const IrcUser &clUser, IrcCaseMapping eCaseMapping, IrcStringPool &clHostnames) {
 			Reset();
-			m_clUser = clUser;
+			m_strUsername = clUser.GetUsername().str();
+			m_clHostname = IrcStringPool::Ref(clHostnames, clUser.GetHostname().c_str());
+			m_clNickname.Set(clUser.GetNickname().str(), eCaseMapping);
 		}
 
 		Member() {
 			Reset();
 		}
 
-		const IrcUser & GetUser() const {
-			return m_clUser;
+		IrcUser GetUser() const {
+			return IrcUser(GetNickname(), m_strUsername, m_clHostname.Get());
 		}
 
-		IrcUser & GetUser() {
-			return m_clUser;
+		const std::string & GetNickname() const {
+			return m_clNickname.GetString();
+		}
+
+		// The nickname and its folded form
+		const IrcKey & GetKey() const {
+			return m_clNickname;
+		}
+
+		void SetNickname(const std::string &strNickname) {
+			m_clNickname.Set(strNickname, m_clNickname.GetCaseMapping());
+		}
+
+		void SetUserHost(IrcStringPool &clHostnames, const std::string &strUsername, const std::string &strHostname) {
+			m_strUsername = strUsername;
+			m_clHostname = IrcStringPool::Ref(clHostnames, strHostname.c_str());
+		}
+
+		bool IsAway() const {
+			return m_bAway;
+		}
+
+		void SetAway(bool bAway) {
+			m_bAway = bAway;
 		}
 
 		time_t GetTimeStamp() const {
@@ -79,14 +108,20 @@ public:
 		}
 
 		void Reset() {
-			m_clUser.Reset();
-			m_timeStamp = time(NULL);
+			m_strUsername = "*";
+			m_clHostname = IrcStringPool::Ref();
+			m_clNickname.Set("*");
+			m_timeStamp = IrcClock::Now();
+			m_bAway = false;
 			ResetVote();
 		}
 
 	private:
-		IrcUser m_clUser;
+		std::string m_strUsername;
+		IrcStringPool::Ref m_clHostname;
+		IrcKey m_clNickname;
 		time_t m_timeStamp;
+		bool m_bAway;
 
 		// For voteban
 		int m_iVote;
@@ -98,13 +133,14 @@ public:
 			Reset();
 		}
 
-		WarningEntry(const std::string &strHostname) {
+		WarningEntry(IrcStringPool &clHostnames, const std::string &strHostname) {
 			Reset();
-			m_strHostname = strHostname;
+			m_clHostname = IrcStringPool::Ref(clHostnames, strHostname.c_str());
 		}
 
-		const std::string & GetHostname() const {
-			return m_strHostname;
+		// NOTE: Only valid until the pool's next Intern() or Release()
+		const char * GetHostname() const {
+			return m_clHostname.Get();
 		}
 
 		time_t GetTimeStamp() const {
@@ -117,45 +153,104 @@ public:
 
 		void Warn() {
 			++m_uiCount;
-			m_timeStamp = time(NULL);
+			m_timeStamp = IrcClock::Now();
 		}
 
 		void Reset() {
-			m_strHostname.clear();
-			m_timeStamp = time(NULL);
+			m_clHostname = IrcStringPool::Ref();
+			m_timeStamp = IrcClock::Now();
 			m_uiCount = 0;
 		}
 
 		bool IsExpired() const {
-			return time(NULL)-m_timeStamp > WARNING_TIMEOUT;
+			return IrcClock::Now()-m_timeStamp > WARNING_TIMEOUT;
 		}
 
-		bool operator==(const std::string &strHostname) const {
-			return !IrcStrCaseCmp(m_strHostname.c_str(), strHostname.c_str());
+		bool operator==(IrcStringPool::Handle hHostname) const {
+			return hHostname != IrcStringPool::INVALID_HANDLE && m_clHostname.GetHandle() == hHostname;
 		}
 
-		bool operator!=(const std::string &strHostname) const {
-			return !(*this == strHostname);
+		bool operator!=(IrcStringPool::Handle hHostname) const {
+			return !(*this == hHostname);
 		}
 
 	private:
-		std::string m_strHostname;
+		IrcStringPool::Ref m_clHostname;
 		time_t m_timeStamp;
 		unsigned int m_uiCount;
 	};
 
+	// An entry on a list mode (ban, ban exception or invite exception)
+	class ListEntry {
+	public:
+		ListEntry(const std::string &strMask, IrcCaseMapping eCaseMapping, bool bMine, time_t timeStamp, bool bPending = false)
+		: m_clMask(strMask, eCaseMapping), m_bMine(bMine), m_bPending(bPending), m_timeStamp(timeStamp), m_removeTime(0) { }
+
+		const std::string & GetMask() const {
+			return m_clMask.GetString();
+		}
+
+		const IrcKey & GetKey() const {
+			return m_clMask;
+		}
+
+		// Set by this bot
+		bool IsMine() const {
+			return m_bMine;
+		}
+
+		// Sent by this bot, but the server hasn't echoed or listed it yet
+		bool IsPending() const {
+			return m_bPending;
+		}
+
+		// Removal sent by this bot, but the server hasn't echoed it yet
+		bool IsRemoving() const {
+			return m_removeTime != 0;
+		}
+
+		// Wall clock time the removal was sent
+		time_t GetRemoveTime() const {
+			return m_removeTime;
+		}
+
+		void SetRemoving(time_t timeStamp) {
+			m_removeTime = timeStamp;
+		}
+
+		void Restore() {
+			m_removeTime = 0;
+		}
+
+		// The server listed or echoed it, so it's set
+		void Confirm() {
+			m_bPending = false;
+			m_removeTime = 0;
+		}
+
+		// Wall clock time it was set
+		time_t GetTimeStamp() const {
+			return m_timeStamp;
+		}
+
+	private:
+		IrcKey m_clMask;
+		bool m_bMine, m_bPending;
+		time_t m_timeStamp, m_removeTime;
+	};
+
 	typedef std::vector<Member>::iterator MemberIterator;
 	typedef std::vector<Member>::const_iterator ConstMemberIterator;
+	typedef std::vector<ListEntry>::const_iterator ConstListIterator;
 	typedef std::vector<WarningEntry>::iterator WarningIterator;
 	typedef std::vector<WarningEntry>::const_iterator ConstWarningIterator;
 
-	BnxChannel() {
-		Reset();
-	}
-
-	BnxChannel(const std::string &strName, IrcCaseMapping eCaseMapping) {
+	// Members, warnings and flood counters intern hostnames in clHostnames, which must outlive the channel
+	BnxChannel(const std::string &strName, IrcCaseMapping eCaseMapping, IrcStringPool &clHostnames) {
+		m_pHostnames = &clHostnames;
+		m_clFloodDetector.SetHostnamePool(m_pHostnames);
 		Reset();
-		m_strName = strName;
+		m_clName.Set(strName, eCaseMapping);
 		m_eCaseMapping = eCaseMapping;
 	}
 
@@ -177,17 +272,29 @@ public:
 
 	void AddMember(const IrcUser &clUser);
 
-	MemberIterator GetMember(const std::string &strNickname);
+	// Looked up by folded hash, no temporary key is built
+	MemberIterator GetMember(const char *pNickname);
 
-	ConstMemberIterator GetMember(const std::string &strNickname) const;
+	ConstMemberIterator GetMember(const char *pNickname) const;
+
+	MemberIterator GetMember(const std::string &strNickname) {
+		return GetMember(strNickname.c_str());
+	}
+
+	ConstMemberIterator GetMember(const std::string &strNickname) const {
+		return GetMember(strNickname.c_str());
+	}
 
-	void DeleteMember(const std::string &strNickname);
+	void DeleteMember(const char *pNickname);
 
 	MemberIterator DeleteMember(MemberIterator memberItr) {
 		return m_vMembers.erase(memberItr);
 	}
 
-	void UpdateMember(const std::string &strNick, const std::string &strNewNick);
+	void UpdateMember(const char *pNick, const std::string &strNewNick);
+
+	// CHGHOST
+	void UpdateMemberHost(const char *pNick, const std::string &strNewUsername, const std::string &strNewHostname);
 
 	WarningIterator WarningBegin() {
 		return m_vWarnings.begin();
@@ -206,11 +313,11 @@ public:
 	}
 
 	WarningIterator GetWarningEntry(const std::string &strHostname) {
-		return std::find(WarningBegin(), WarningEnd(), strHostname);
+		return std::find(WarningBegin(), WarningEnd(), m_pHostnames->Find(strHostname.c_str()));
 	}
 
 	ConstWarningIterator GetWarningEntry(const std::string &strHostname) const {
-		return std::find(WarningBegin(), WarningEnd(), strHostname);
+		return std::find(WarningBegin(), WarningEnd(), m_pHostnames->Find(strHostname.c_str()));
 	}
 
 	WarningIterator Warn(const std::string &strHostname);
@@ -223,6 +330,46 @@ public:
 
 	void ExpireWarningEntries();
 
+	// List modes are 'b' and whatever EXCEPTS and INVEX name, entries come from RPL_BANLIST (and friends) and MODE
+	// Returns false if the mask was already listed (which confirms a pending entry unless bPending is set)
+	bool AddListEntry(char mode, const std::string &strMask, bool bMine, time_t timeStamp, bool bPending = false);
+
+	// Returns false if the mask wasn't listed
+	bool DeleteListEntry(char mode, const std::string &strMask);
+
+	// Drops a pending entry the server refused, returns false if strMask isn't pending
+	bool DeletePendingListEntry(char mode, const std::string &strMask);
+
+	// Drops pending entries and restores entries marked for removal (of any list) queued at or before timeStamp
+	size_t DeletePendingListEntries(time_t timeStamp);
+
+	// Marks an entry whose removal was sent, it stays listed until the server echoes that, returns false if strMask isn't listed
+	bool SetListEntryRemoving(char mode, const std::string &strMask, time_t timeStamp);
+
+	bool HasListEntry(char mode, const std::string &strMask) const;
+
+	// Entries marked for removal aren't counted
+	size_t GetListSize(char mode) const;
+
+	ConstListIterator ListBegin(char mode) const;
+	ConstListIterator ListEnd(char mode) const;
+
+	// The earliest entry this bot set that isn't marked for removal, or ListEnd()
+	ConstListIterator GetOldestOwnListEntry(char mode) const;
+
+	// The whole list has been received since joining
+	bool IsListSynced(char mode) const;
+	void SetListSynced(char mode);
+
+	// Members are known (WHO or RPL_NAMEREPLY with userhost-in-names finished)
+	bool IsSynced() const {
+		return m_bSynced;
+	}
+
+	void SetSynced(bool bSynced) {
+		m_bSynced = bSynced;
+	}
+
 	bool IsOperator() const {
 		return m_bIsOperator;
 	}
@@ -233,8 +380,8 @@ public:
 
 	void VoteBan(const IrcUser &clUser);
 
-	void VoteYay(const std::string &strNickname);
-	void VoteNay(const std::string &strNickname);
+	void VoteYay(const char *pNickname);
+	void VoteNay(const char *pNickname);
 
 	int TallyVote() const {
 		return m_iVoteCount;
@@ -253,14 +400,18 @@ public:
 	}
 
 	bool VoteBanExpired() const {
-		return time(NULL) - GetVoteBanTime() >= VOTEBAN_TIMEOUT;
+		return IrcClock::Now() - GetVoteBanTime() >= VOTEBAN_TIMEOUT;
 	}
 
 	void ResetVoteBan();
 	void Reset();
 
 	const std::string & GetName() const {
-		return m_strName;
+		return m_clName.GetString();
+	}
+
+	const IrcKey & GetKey() const {
+		return m_clName;
 	}
 
 	size_t GetSize() const {
@@ -272,19 +423,38 @@ public:
 	}
 
 	bool operator==(const std::string &strName) const {
-		return !IrcStrCaseCmp(m_strName.c_str(), strName.c_str(), m_eCaseMapping);
+		return m_clName == IrcKey(strName, m_eCaseMapping);
 	}
 
 	bool operator!=(const std::string &strName) const {
 		return !(*this == strName);
 	}
 
+	// NOTE: The key should be folded with this channel's case mapping
+	bool operator==(const IrcKey &clName) const {
+		return m_clName == clName;
+	}
+
+	bool operator!=(const IrcKey &clName) const {
+		return !(*this == clName);
+	}
+
 private:
-	std::string m_strName;
+	IrcKey m_clName;
 	IrcCaseMapping m_eCaseMapping;
+	IrcStringPool *m_pHostnames;
 	std::vector<Member> m_vMembers;
 	std::vector<WarningEntry> m_vWarnings;
-	bool m_bIsOperator;
+	bool m_bIsOperator, m_bSynced;
+
+	struct ModeList {
+		char mode;
+		bool bSynced;
+		std::vector<ListEntry> vEntries;
+	};
+
+	// A few at most
+	std::vector<ModeList> m_vModeLists;
 	BnxFloodDetector m_clFloodDetector;
 
 	// For voteban
@@ -292,6 +462,9 @@ private:
 	IrcUser m_clVoteBanMask;
 	time_t m_voteBanTime;
 	int m_iVoteCount;
+
+	ModeList * FindModeList(char mode);
+	const ModeList * FindModeList(char mode) const;
 };
 
 #endif // !BNXCHANNEL_H
@@ -0,0 +1,202 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "BnxChannelSync.h"
+
+void BnxChannelSync::QueueJoin(const std::string &strChannel) {
+	if (Find(m_dqJoins, strChannel.c_str()) == m_dqJoins.end())
+		m_dqJoins.push_back(strChannel);
+}
+
+bool BnxChannelSync::PopJoinLine(std::string &strLine) {
+	if (m_dqJoins.empty())
+		return false;
+
+	strLine = "JOIN ";
+	strLine += m_dqJoins.front();
+	m_dqJoins.pop_front();
+
+	while (!m_dqJoins.empty() && strLine.size() + 1 + m_dqJoins.front().size() <= MAX_LINE_SIZE) {
+		strLine += ',';
+		strLine += m_dqJoins.front();
+		m_dqJoins.pop_front();
+	}
+
+	return true;
+}
+
+void BnxChannelSync::QueueQuery(const std::string &strChannel) {
+	if (FindQueued(strChannel.c_str()) == m_dqQueries.end() &&
+		FindOutstanding(strChannel.c_str()) == m_vOutstanding.end()) {
+		Query clQuery;
+		clQuery.strChannel = strChannel;
+		clQuery.bAnswered = false;
+		clQuery.retryCount = 0;
+
+		m_dqQueries.push_back(clQuery);
+	}
+}
+
+bool BnxChannelSync::PopQuery(std::string &strChannel) {
+	if (m_dqQueries.empty() || m_vOutstanding.size() >= m_window)
+		return false;
+
+	m_vOutstanding.push_back(m_dqQueries.front());
+	m_dqQueries.pop_front();
+
+	Query &clQuery = m_vOutstanding.back();
+	clQuery.stSent = IrcClock::GetTime();
+	clQuery.bAnswered = false;
+
+	strChannel = clQuery.strChannel;
+
+	return true;
+}
+
+void BnxChannelSync::NoteReply(const char *pChannel) {
+	std::vector<Query>::iterator itr = FindOutstanding(pChannel);
+
+	if (itr == m_vOutstanding.end() || itr->bAnswered)
+		return;
+
+	itr->bAnswered = true;
+	Observe(itr->stSent);
+}
+
+bool BnxChannelSync::FinishQuery(const char *pChannel) {
+	std::vector<Query>::iterator itr = FindOutstanding(pChannel);
+
+	if (itr == m_vOutstanding.end())
+		return false;
+
+	// Empty reply
+	if (!itr->bAnswered)
+		Observe(itr->stSent);
+
+	m_vOutstanding.erase(itr);
+
+	return true;
+}
+
+void BnxChannelSync::Cancel(const char *pChannel) {
+	std::deque<std::string>::iterator channelItr = Find(m_dqJoins, pChannel);
+
+	if (channelItr != m_dqJoins.end())
+		m_dqJoins.erase(channelItr);
+
+	std::deque<Query>::iterator queuedItr = FindQueued(pChannel);
+
+	if (queuedItr != m_dqQueries.end())
+		m_dqQueries.erase(queuedItr);
+
+	std::vector<Query>::iterator queryItr = FindOutstanding(pChannel);
+
+	if (queryItr != m_vOutstanding.end())
+		m_vOutstanding.erase(queryItr);
+}
+
+size_t BnxChannelSync::ExpireQueries(std::vector<std::string> &vGivenUp) {
+	const time_t now = IrcClock::Now();
+	size_t expiredCount = 0;
+
+	for (size_t i = 0; i < m_vOutstanding.size(); ) {
+		Query &clQuery = m_vOutstanding[i];
+
+		if (now - clQuery.stSent.tv_sec < QUERY_TIMEOUT) {
+			++i;
+			continue;
+		}
+
+		// Ahead of channels that were never tried
+		if (clQuery.retryCount < MAX_QUERY_RETRIES) {
+			++clQuery.retryCount;
+			m_dqQueries.push_front(clQuery);
+		}
+		else {
+			vGivenUp.push_back(clQuery.strChannel);
+		}
+
+		m_vOutstanding.erase(m_vOutstanding.begin() + i);
+		++expiredCount;
+	}
+
+	// Lost queries mean the server is struggling
+	if (expiredCount > 0)
+		m_window = MIN_WINDOW;
+
+	return expiredCount;
+}
+
+void BnxChannelSync::Reset() {
+	m_dqJoins.clear();
+	m_dqQueries.clear();
+	m_vOutstanding.clear();
+	m_window = DEFAULT_WINDOW;
+}
+
+std::deque<std::string>::iterator BnxChannelSync::Find(std::deque<std::string> &dqChannels, const char *pChannel) {
+	std::deque<std::string>::iterator itr;
+
+	for (itr = dqChannels.begin(); itr != dqChannels.end(); ++itr) {
+		if (!IrcStrCaseCmp(itr->c_str(), pChannel, m_eCaseMapping))
+			break;
+	}
+
+	return itr;
+}
+
+std::deque<BnxChannelSync::Query>::iterator BnxChannelSync::FindQueued(const char *pChannel) {
+	std::deque<Query>::iterator itr;
+
+	for (itr = m_dqQueries.begin(); itr != m_dqQueries.end(); ++itr) {
+		if (!IrcStrCaseCmp(itr->strChannel.c_str(), pChannel, m_eCaseMapping))
+			break;
+	}
+
+	return itr;
+}
+
+std::vector<BnxChannelSync::Query>::iterator BnxChannelSync::FindOutstanding(const char *pChannel) {
+	std::vector<Query>::iterator itr;
+
+	for (itr = m_vOutstanding.begin(); itr != m_vOutstanding.end(); ++itr) {
+		if (!IrcStrCaseCmp(itr->strChannel.c_str(), pChannel, m_eCaseMapping))
+			break;
+	}
+
+	return itr;
+}
+
+void BnxChannelSync::Observe(const struct timeval &stSent) {
+	const struct timeval &stNow = IrcClock::GetTime();
+
+	const long elapsedMs = (long)(stNow.tv_sec - stSent.tv_sec)*1000 + (stNow.tv_usec - stSent.tv_usec)/1000;
+
+	if (elapsedMs <= FAST_REPLY_MS)
+		m_window = std::min<size_t>(m_window + 1, MAX_WINDOW);
+	else if (elapsedMs >= SLOW_REPLY_MS)
+		m_window = std::max<size_t>(m_window / 2, MIN_WINDOW);
+}
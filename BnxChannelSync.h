@@ -0,0 +1,122 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BNXCHANNELSYNC_H
+#define BNXCHANNELSYNC_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "IrcString.h"
+#include "IrcClock.h"
+
+// Paces joins and member queries so that (re)connecting to many channels doesn't arrive as one burst
+// Channels waiting to be joined leave in comma separated JOIN lines. Joined channels wait here to have
+// their state queried (WHO and list modes) and only a window of channels is queried at a time.
+// The window grows while the server answers quickly and halves when it falls behind.
+// A query is timed from when it's handed out, so time spent in the client's send queue counts as slow
+// too, which keeps the window small while our own output is backed up.
+
+class BnxChannelSync {
+public:
+	enum { MAX_LINE_SIZE = 510, MIN_WINDOW = 1, MAX_WINDOW = 8, DEFAULT_WINDOW = 2, 
+		FAST_REPLY_MS = 2000, SLOW_REPLY_MS = 8000, QUERY_TIMEOUT = 60, MAX_QUERY_RETRIES = 2 };
+
+	BnxChannelSync() {
+		m_eCaseMapping = RFC1459;
+		Reset();
+	}
+
+	void SetCaseMapping(IrcCaseMapping eCaseMapping) {
+		m_eCaseMapping = eCaseMapping;
+	}
+
+	// Ignored if the channel is already waiting
+	void QueueJoin(const std::string &strChannel);
+
+	bool HasPendingJoins() const {
+		return !m_dqJoins.empty();
+	}
+
+	// Gets a JOIN command (without CRLF) with as many waiting channels as fit in a line
+	bool PopJoinLine(std::string &strLine);
+
+	// Ignored if the channel is already waiting or being queried
+	void QueueQuery(const std::string &strChannel);
+
+	bool HasPendingQueries() const {
+		return !m_dqQueries.empty();
+	}
+
+	// Gets the next channel to query if the window allows it
+	bool PopQuery(std::string &strChannel);
+
+	// A reply for the channel arrived (measures how quickly the server answers)
+	void NoteReply(const char *pChannel);
+
+	// The last reply of the channel's queries, returns false if the channel wasn't being queried
+	bool FinishQuery(const char *pChannel);
+
+	// Forgets a channel we left
+	void Cancel(const char *pChannel);
+
+	// Queries not answered within QUERY_TIMEOUT seconds are queued again, up to MAX_QUERY_RETRIES times
+	// Returns how many expired, the channels given up on are added to vGivenUp
+	size_t ExpireQueries(std::vector<std::string> &vGivenUp);
+
+	size_t GetWindow() const {
+		return m_window;
+	}
+
+	size_t GetOutstandingCount() const {
+		return m_vOutstanding.size();
+	}
+
+	void Reset();
+
+private:
+	struct Query {
+		std::string strChannel;
+		struct timeval stSent;
+		bool bAnswered;
+		unsigned int retryCount;
+	};
+
+	IrcCaseMapping m_eCaseMapping;
+
+	std::deque<std::string> m_dqJoins;
+	std::deque<Query> m_dqQueries;
+	std::vector<Query> m_vOutstanding;
+	size_t m_window;
+
+	std::deque<std::string>::iterator Find(std::deque<std::string> &dqChannels, const char *pChannel);
+	std::deque<Query>::iterator FindQueued(const char *pChannel);
+	std::vector<Query>::iterator FindOutstanding(const char *pChannel);
+
+	// Adjusts the window by how long the server took to start answering
+	void Observe(const struct timeval &stSent);
+};
+
+#endif // !BNXCHANNELSYNC_H
@@ -0,0 +1,108 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "BnxCtcpResponder.h"
+#include "IrcString.h"
+
+bool BnxCtcpResponder::Queue(const IrcUser &clUser, const std::string &strLine) {
+	if (std::find(m_dqPending.begin(), m_dqPending.end(), strLine) != m_dqPending.end()) {
+		++m_collapsedCount;
+		return false;
+	}
+
+	TokenBucket &clBucket = m_aHostBuckets[IrcStrCaseHash(clUser.GetHostname().c_str(), ASCII) & (HOST_SLOTS-1)];
+
+	Refill(clBucket, m_fHostRate, m_fHostBurst);
+
+	if (clBucket.fTokens < 1.0f || m_dqPending.size() >= m_maxPending) {
+		++m_droppedCount;
+		return false;
+	}
+
+	clBucket.fTokens -= 1.0f;
+
+	m_dqPending.push_back(strLine);
+
+	return true;
+}
+
+bool BnxCtcpResponder::Pop(std::string &strLine) {
+	if (m_dqPending.empty())
+		return false;
+
+	Refill(m_clGlobalBucket, m_fGlobalRate, m_fGlobalBurst);
+
+	if (m_clGlobalBucket.fTokens < 1.0f)
+		return false;
+
+	m_clGlobalBucket.fTokens -= 1.0f;
+
+	strLine.swap(m_dqPending.front());
+	m_dqPending.pop_front();
+
+	++m_answeredCount;
+
+	return true;
+}
+
+unsigned int BnxCtcpResponder::GetWaitTime() const {
+	TokenBucket clBucket = m_clGlobalBucket;
+
+	Refill(clBucket, m_fGlobalRate, m_fGlobalBurst);
+
+	if (clBucket.fTokens >= 1.0f)
+		return 0;
+
+	return (unsigned int)((1.0f - clBucket.fTokens) * 1000.0f / m_fGlobalRate) + 1;
+}
+
+void BnxCtcpResponder::Reset() {
+	m_dqPending.clear();
+
+	Fill(m_clGlobalBucket, m_fGlobalBurst);
+
+	for (size_t i = 0; i < HOST_SLOTS; ++i)
+		Fill(m_aHostBuckets[i], m_fHostBurst);
+}
+
+void BnxCtcpResponder::Refill(TokenBucket &clBucket, float fRate, float fBurst) {
+	const struct timeval &stNow = IrcClock::GetTime();
+
+	const float fElapsed = (stNow.tv_sec - clBucket.stLast.tv_sec) + (stNow.tv_usec - clBucket.stLast.tv_usec) * 1e-6f;
+
+	clBucket.stLast = stNow;
+
+	// A virtual clock may go backwards
+	if (fElapsed <= 0.0f)
+		return;
+
+	clBucket.fTokens = std::min(fBurst, clBucket.fTokens + fElapsed * fRate);
+}
+
+void BnxCtcpResponder::Fill(TokenBucket &clBucket, float fBurst) {
+	clBucket.fTokens = fBurst;
+	clBucket.stLast = IrcClock::GetTime();
+}
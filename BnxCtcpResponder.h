@@ -0,0 +1,117 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BNXCTCPRESPONDER_H
+#define BNXCTCPRESPONDER_H
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include "IrcUser.h"
+#include "IrcClock.h"
+
+// Rate limits CTCP replies so that floods of requests can't fill the send queue
+// Each hostname has a token bucket (hostnames hash into HOST_SLOTS buckets) that decides whether a reply is queued at all.
+// Queued replies wait here and leave at the rate of one global token bucket, identical replies are only queued once.
+
+class BnxCtcpResponder {
+public:
+	enum { HOST_SLOTS = 1024, DEFAULT_MAX_PENDING = 8 };
+
+	BnxCtcpResponder() {
+		SetGlobalRate(1.0f, 4.0f);
+		SetHostRate(0.1f, 2.0f);
+		SetMaxPending(DEFAULT_MAX_PENDING);
+		m_answeredCount = m_droppedCount = m_collapsedCount = 0;
+		Reset();
+	}
+
+	// Replies per second and the most sent in a burst
+	// Pending replies wait for a whole token, so the rate is at least one reply per 100 seconds and the burst at least one
+	void SetGlobalRate(float fRate, float fBurst) {
+		m_fGlobalRate = std::max(fRate, 0.01f);
+		m_fGlobalBurst = std::max(fBurst, 1.0f);
+	}
+
+	void SetHostRate(float fRate, float fBurst) {
+		m_fHostRate = fRate;
+		m_fHostBurst = fBurst;
+	}
+
+	void SetMaxPending(size_t maxPending) {
+		m_maxPending = maxPending;
+	}
+
+	// strLine is the complete reply, returns false when it was dropped or collapsed
+	bool Queue(const IrcUser &clUser, const std::string &strLine);
+
+	// Gets the next reply if the global rate allows it
+	bool Pop(std::string &strLine);
+
+	bool HasPending() const {
+		return !m_dqPending.empty();
+	}
+
+	// Milliseconds until Pop() can succeed
+	unsigned int GetWaitTime() const;
+
+	unsigned int GetAnsweredCount() const {
+		return m_answeredCount;
+	}
+
+	// Over the hostname's rate or with too many replies pending
+	unsigned int GetDroppedCount() const {
+		return m_droppedCount;
+	}
+
+	// Identical to a pending reply
+	unsigned int GetCollapsedCount() const {
+		return m_collapsedCount;
+	}
+
+	// Drops pending replies and refills the buckets, the counters are kept
+	void Reset();
+
+private:
+	struct TokenBucket {
+		float fTokens;
+		struct timeval stLast;
+	};
+
+	float m_fGlobalRate, m_fGlobalBurst, m_fHostRate, m_fHostBurst;
+	size_t m_maxPending;
+
+	TokenBucket m_clGlobalBucket;
+	TokenBucket m_aHostBuckets[HOST_SLOTS];
+
+	std::deque<std::string> m_dqPending;
+
+	unsigned int m_answeredCount, m_droppedCount, m_collapsedCount;
+
+	static void Refill(TokenBucket &clBucket, float fRate, float fBurst);
+	static void Fill(TokenBucket &clBucket, float fBurst);
+};
+
+#endif // !BNXCTCPRESPONDER_H
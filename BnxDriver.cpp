@@ -28,6 +28,8 @@
 #include "getopt.h"
 #include "BnxDriver.h"
 #include "BnxStreams.h"
+#include "IrcClock.h"
+#include "IrcString.h"
 
 #if defined(__unix__)
 #include "BnxUnixDriver.h"
@@ -53,6 +55,7 @@ BnxDriver & BnxDriver::GetInstance() {
 
 BnxDriver::~BnxDriver() {
 	BnxDriver::Reset();
+	m_clTimerWheel.SetEventBase(NULL);
 	event_base_free(m_pEventBase);
 	m_pEventBase = NULL;
 }
@@ -118,8 +121,11 @@ bool BnxDriver::Run() {
 	if (!Load() || m_vBots.empty())
 		return false;
 
+	IrcClock::Update();
+
 	for (size_t i = 0; i < m_vBots.size(); ++i) {
 		m_vBots[i]->SetEventBase(GetEventBase());
+		m_vBots[i]->SetTimerWheel(&m_clTimerWheel);
 		m_vBots[i]->StartUp();
 	}
 
@@ -138,6 +144,8 @@ void BnxDriver::Reset() {
 		delete m_vBots[i];
 
 	m_vBots.clear();
+
+	m_clResponseEngineCache.Reset();
 }
 
 void BnxDriver::LoadBot(const IniFile::Section &clSection) {
@@ -161,7 +169,11 @@ void BnxDriver::LoadBot(const IniFile::Section &clSection) {
 		m_vBots.push_back(pclBot);
 	}
 
-	std::string strPort = clSection.GetValue<std::string>("port", "6667");
+	bool bTls = clSection.GetValue<bool>("tls", false);
+	bool bTlsVerify = clSection.GetValue<bool>("tlsverify", true);
+	std::string strTlsCert = clSection.GetValue<std::string>("tlscert", "");
+	std::string strTlsKey = clSection.GetValue<std::string>("tlskey", "");
+	std::string strPort = clSection.GetValue<std::string>("port", bTls ? "6697" : "6667");
 	std::string strUsername = clSection.GetValue<std::string>("username", "BnxBot");
 	std::string strRealName = clSection.GetValue<std::string>("realname", "BnxBot");
 	std::string strAccessList = clSection.GetValue<std::string>("accesslist", "access.lst");
@@ -171,18 +183,34 @@ void BnxDriver::LoadBot(const IniFile::Section &clSection) {
 	std::string strHomeChannels = clSection.GetValue<std::string>("homechannels", "");
 	std::string strNickServ = clSection.GetValue<std::string>("nickserv", "");
 	std::string strNickServPassword = clSection.GetValue<std::string>("nickservpassword", "");
+	std::string strSasl = clSection.GetValue<std::string>("sasl", strNickServPassword.empty() ? "none" : "plain");
+	int iSquelchTime = clSection.GetValue<int>("squelchtime", 3600);
+	int iSquelchListSize = clSection.GetValue<int>("squelchlistsize", BnxSquelchList::DEFAULT_MAX_SIZE);
 	
 	pclBot->SetServerAndPort(strServer, strPort);
+	pclBot->SetTls(bTls, bTlsVerify);
+	pclBot->SetTlsCertificate(strTlsCert, strTlsKey);
 	pclBot->SetNickServAndPassword(strNickServ, strNickServPassword);
+
+	// The account is the configured nickname, like NickServ identify
+	if (!IrcStrCaseCmp(strSasl.c_str(), "plain") && !strNickServPassword.empty())
+		pclBot->SetSasl(IrcClient::SASL_PLAIN, strNickname, strNickServPassword);
+	else if (!IrcStrCaseCmp(strSasl.c_str(), "external"))
+		pclBot->SetSasl(IrcClient::SASL_EXTERNAL);
+	else
+		pclBot->SetSasl(IrcClient::SASL_NONE);
+
 	pclBot->SetNickname(strNickname);
 	pclBot->SetUsername(strUsername);
 	pclBot->SetRealName(strRealName);
-	pclBot->LoadResponseRules(strResponseRules);
+	pclBot->SetResponseEngine(m_clResponseEngineCache.Load(strResponseRules));
 	pclBot->LoadAccessList(strAccessList);
 	pclBot->LoadShitList(strShitList);
 	pclBot->LoadSeenList(strSeenList);
 	pclBot->SetLogFile(m_strLogFile);
 	pclBot->SetHomeChannels(strHomeChannels);
+	pclBot->SetSquelchTime(iSquelchTime);
+	pclBot->SetSquelchListSize(iSquelchListSize > 0 ? iSquelchListSize : 1);
 }
 
 BnxBot * BnxDriver::GetBot(const std::string &strProfile) const {
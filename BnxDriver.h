@@ -33,7 +33,9 @@
 #include <iostream>
 #include "event2/event.h"
 #include "IniFile.h"
+#include "IrcTimerWheel.h"
 #include "BnxBot.h"
+#include "BnxResponseEngineCache.h"
 
 class BnxDriver {
 public:
@@ -45,6 +47,7 @@ public:
 		m_strConfigFile = "bot.ini";
 		m_strLogFile = "bot.log";
 		m_pEventBase = event_base_new();
+		m_clTimerWheel.SetEventBase(m_pEventBase);
 	}
 
 	virtual ~BnxDriver();
@@ -80,6 +83,12 @@ private:
 	std::vector<BnxBot *> m_vBots;
 	struct event_base *m_pEventBase;
 
+	// All bots' timers run off one libevent timer
+	IrcTimerWheel m_clTimerWheel;
+
+	// Profiles with the same response rules file share one compiled copy
+	BnxResponseEngineCache m_clResponseEngineCache;
+
 	// Disabled
 	BnxDriver(const BnxDriver &);
 
@@ -27,41 +27,60 @@
 #include "BnxFloodDetector.h"
 
 IrcCounter & BnxFloodDetector::GetCounter(const IrcUser &clUser) {
-	std::vector<std::pair<IrcUser, IrcCounter> >::iterator itr;
+	const char * const pHostname = clUser.GetHostname().c_str();
+	IrcStringPool::Handle hHostname = IrcStringPool::INVALID_HANDLE;
 
-	itr = std::find_if(m_vFloodCounters.begin(), 
-				m_vFloodCounters.end(), 
-				HostnameEquals(clUser.GetHostname()));
+	// A hostname the pool has never seen has no counter
+	if (m_pHostnames != NULL)
+		hHostname = m_pHostnames->Find(pHostname);
 
-	if (itr != m_vFloodCounters.end())
-		return itr->second;
+	if (m_pHostnames == NULL || hHostname != IrcStringPool::INVALID_HANDLE) {
+		std::vector<FloodCounter>::iterator itr;
 
-	m_vFloodCounters.push_back(std::make_pair(clUser,IrcCounter(GetTimeStep())));
+		itr = std::find_if(m_vFloodCounters.begin(), 
+					m_vFloodCounters.end(), 
+					HostnameEquals(hHostname, pHostname));
 
-	return m_vFloodCounters.back().second;
+		if (itr != m_vFloodCounters.end())
+			return itr->clCounter;
+	}
+
+	m_vFloodCounters.push_back(FloodCounter());
+
+	FloodCounter &clFloodCounter = m_vFloodCounters.back();
+
+	clFloodCounter.strNickname = clUser.GetNickname().str();
+	clFloodCounter.strUsername = clUser.GetUsername().str();
+	clFloodCounter.clCounter = IrcCounter(GetTimeStep());
+
+	if (m_pHostnames != NULL)
+		clFloodCounter.clHostname = IrcStringPool::Ref(*m_pHostnames, pHostname);
+	else
+		clFloodCounter.strHostname = pHostname;
+
+	return clFloodCounter.clCounter;
 }
 
 void BnxFloodDetector::Detect(std::vector<IrcUser> &vFlooders) {
 	vFlooders.clear();
 
-	std::vector<std::pair<IrcUser, IrcCounter> >::iterator itr;
+	std::vector<FloodCounter>::iterator itr;
 
 	itr = m_vFloodCounters.begin();
 
 	while (itr != m_vFloodCounters.end()) {
-		const IrcUser &clUser = itr->first;
-		IrcCounter &clCounter = itr->second;
+		IrcCounter &clCounter = itr->clCounter;
 
 		float fRate = clCounter.SampleRate();
 
 		if (fRate <= 0) {
 			itr = m_vFloodCounters.erase(itr);
-			// XXX: clUser and clCounter are no longer valid references
+			// XXX: clCounter is no longer a valid reference
 		}
 		else if (fRate > GetThreshold()) {
-			vFlooders.push_back(clUser);
+			vFlooders.push_back(itr->GetUser());
 			itr = m_vFloodCounters.erase(itr);
-			// XXX: clUser and clCounter are no longer valid references
+			// XXX: clCounter is no longer a valid reference
 		}
 		else {
 			++itr;
@@ -26,20 +26,29 @@
 #ifndef BNXFLOODDETECTOR_H
 #define BNXFLOODDETECTOR_H
 
+#include <string>
 #include <utility>
 #include <vector>
 #include "IrcString.h"
 #include "IrcUser.h"
 #include "IrcCounter.h"
+#include "IrcStringPool.h"
 
 class BnxFloodDetector {
 public:
 	BnxFloodDetector(float fThreshold = 3.0f, float fTimeStep = 1.0f) {
 		SetThreshold(fThreshold);
 		SetTimeStep(fTimeStep);
+		m_pHostnames = NULL;
 		Reset();
 	}
 
+	// Counters then hold interned hostnames and are found by handle
+	// NOTE: Set before the first Hit(), the pool must outlive the detector
+	void SetHostnamePool(IrcStringPool *pHostnames) {
+		m_pHostnames = pHostnames;
+	}
+
 	float GetTimeStep() const {
 		return m_fTimeStep;
 	}
@@ -69,22 +78,35 @@ public:
 	}
 
 private:
+	struct FloodCounter {
+		std::string strNickname, strUsername;
+		IrcStringPool::Ref clHostname; // Unset without a pool
+		std::string strHostname; // Only without a pool
+		IrcCounter clCounter;
+
+		IrcUser GetUser() const {
+			return IrcUser(strNickname, strUsername, clHostname.GetHandle() != IrcStringPool::INVALID_HANDLE ? clHostname.Get() : strHostname.c_str());
+		}
+	};
+
 	struct HostnameEquals {
-		HostnameEquals(const std::string &strHostname_)
-		: strHostname(strHostname_) { }
+		HostnameEquals(IrcStringPool::Handle hHostname_, const char *pHostname_)
+		: hHostname(hHostname_), pHostname(pHostname_) { }
 
-		bool operator()(const std::pair<IrcUser, IrcCounter> &clPair) const {
-			const IrcUser &clUser = clPair.first;
-			const std::string &strHostname2 = clUser.GetHostname();
+		bool operator()(const FloodCounter &clFloodCounter) const {
+			if (clFloodCounter.clHostname.GetHandle() != IrcStringPool::INVALID_HANDLE)
+				return clFloodCounter.clHostname.GetHandle() == hHostname;
 
-			return !IrcStrCaseCmp(strHostname.c_str(), strHostname2.c_str());
+			return !IrcStrCaseCmp(pHostname, clFloodCounter.strHostname.c_str());
 		}
 
-		const std::string &strHostname;
+		IrcStringPool::Handle hHostname;
+		const char *pHostname;
 	};
 
 	float m_fTimeStep, m_fThreshold;
-	std::vector<std::pair<IrcUser, IrcCounter> > m_vFloodCounters;
+	IrcStringPool *m_pHostnames;
+	std::vector<FloodCounter> m_vFloodCounters;
 };
 
 #endif // !BNXFLOODDETECTOR_H
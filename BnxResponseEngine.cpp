@@ -71,8 +71,7 @@ bool BnxResponseEngine::LoadFromStream(std::istream &is) {
 
 			if (mode == 'R') {
 				// Rule completed
-				m_vRules.push_back(clRule);
-				clRule.Reset();
+				AddRule(clRule);
 			}
 
 			mode = 'P';
@@ -120,7 +119,7 @@ bool BnxResponseEngine::LoadFromStream(std::istream &is) {
 		return false;
 	}
 	else if (mode == 'R') 
-		m_vRules.push_back(clRule);
+		AddRule(clRule);
 
 	return true;
 }
@@ -128,9 +127,9 @@ bool BnxResponseEngine::LoadFromStream(std::istream &is) {
 void BnxResponseEngine::SaveToStream(std::ostream &os) const {
 	std::vector<std::string> vRegexRules;
 
-	for (size_t i = 0; i < m_vRules.size(); ++i) {
-		const std::vector<std::string> &vResponses = m_vRules[i].GetResponses();
-		m_vRules[i].GetRules(vRegexRules);
+	for (size_t i = 0; i < m_dqRules.size(); ++i) {
+		const std::vector<std::string> &vResponses = m_dqRules[i].GetResponses();
+		m_dqRules[i].GetRules(vRegexRules);
 
 		for (size_t j = 0; j < vRegexRules.size(); ++j)
 			os << "P " << vRegexRules[j] << std::endl;
@@ -28,6 +28,7 @@
 
 #include <cstdlib>
 #include <algorithm>
+#include <deque>
 #include <iostream>
 #include "BnxResponseRule.h"
 
@@ -55,11 +56,11 @@ public:
 	}
 
 	const std::string & ComputeResponse(const std::string &strMessage) const {
-		std::vector<BnxResponseRule>::const_iterator itr;
+		std::deque<BnxResponseRule>::const_iterator itr;
 
-		itr = std::find(m_vRules.begin(), m_vRules.end(), strMessage);
+		itr = std::find(m_dqRules.begin(), m_dqRules.end(), strMessage);
 
-		if (itr == m_vRules.end()) {
+		if (itr == m_dqRules.end()) {
 			const std::vector<std::string> &vDefaultResponses = (!strMessage.empty() && *strMessage.rbegin() == '?') ? 
 										m_vDefaultQuestionResponses : 
 										m_vDefaultStatementResponses;
@@ -75,11 +76,18 @@ public:
 	}
 
 	void Reset() {
-		m_vRules.clear();
+		m_dqRules.clear();
 	}
 
 private:
-	std::vector<BnxResponseRule> m_vRules;
+	// Takes clRule's compiled regexes, leaving it empty
+	void AddRule(BnxResponseRule &clRule) {
+		m_dqRules.push_back(BnxResponseRule());
+		m_dqRules.back().Swap(clRule);
+	}
+
+	// Copying a rule compiles its regexes again, a deque never moves them
+	std::deque<BnxResponseRule> m_dqRules;
 	std::vector<std::string> m_vDefaultStatementResponses, m_vDefaultQuestionResponses;
 };
 
@@ -0,0 +1,70 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <fstream>
+#include <sstream>
+#include "BnxResponseEngineCache.h"
+
+BnxResponseEngineCache::EnginePtr BnxResponseEngineCache::Load(const std::string &strFileName) {
+	std::ifstream fileStream(strFileName.c_str(), std::ios::in | std::ios::binary);
+
+	if (!fileStream)
+		return EnginePtr();
+
+	std::stringstream contentsStream;
+	contentsStream << fileStream.rdbuf();
+
+	const std::string &strContents = contentsStream.str();
+	const unsigned int hash = Hash(strContents);
+
+	Entry &clEntry = m_mEntries[strFileName];
+
+	if (!clEntry.pEngine.IsNull() && clEntry.hash == hash && clEntry.strContents == strContents)
+		return clEntry.pEngine;
+
+	// Bots holding the old engine keep it until they let go
+	BnxResponseEngine *pEngine = new BnxResponseEngine();
+
+	std::istringstream rulesStream(strContents);
+	pEngine->LoadFromStream(rulesStream);
+
+	clEntry.hash = hash;
+	clEntry.strContents = strContents;
+	clEntry.pEngine = EnginePtr(pEngine);
+
+	return clEntry.pEngine;
+}
+
+unsigned int BnxResponseEngineCache::Hash(const std::string &strContents) {
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+
+	for (size_t i = 0; i < strContents.size(); ++i) {
+		hash ^= (unsigned char)strContents[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
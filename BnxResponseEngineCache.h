@@ -0,0 +1,66 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BNXRESPONSEENGINECACHE_H
+#define BNXRESPONSEENGINECACHE_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include "BnxResponseEngine.h"
+#include "BnxSharedPtr.h"
+
+// Compiled response rules shared by every bot that loads the same file
+// Engines are immutable once cached, a file that changed on disk is compiled again.
+
+class BnxResponseEngineCache {
+public:
+	typedef BnxSharedPtr<const BnxResponseEngine> EnginePtr;
+
+	// NULL when the file can't be read, an engine with only default responses when it doesn't parse
+	EnginePtr Load(const std::string &strFileName);
+
+	size_t GetSize() const {
+		return m_mEntries.size();
+	}
+
+	void Reset() {
+		m_mEntries.clear();
+	}
+
+private:
+	struct Entry {
+		unsigned int hash;
+		std::string strContents;
+		EnginePtr pEngine;
+	};
+
+	// By file name
+	std::map<std::string, Entry> m_mEntries;
+
+	static unsigned int Hash(const std::string &strContents);
+};
+
+#endif // !BNXRESPONSEENGINECACHE_H
@@ -88,6 +88,12 @@ public:
 		m_vResponses.clear();
 	}
 
+	// Swaps without compiling anything
+	void Swap(BnxResponseRule &clRule) {
+		m_vRegexRules.swap(clRule.m_vRegexRules);
+		m_vResponses.swap(clRule.m_vResponses);
+	}
+
 	bool operator==(const std::string &strMessage) const {
 		for (size_t i = 0; i < m_vRegexRules.size(); ++i) {
 			//std::cout << "Matching: '" << strMessage << "' against '" << m_vRegexRules[i].first << "'" << std::endl;
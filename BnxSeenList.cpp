@@ -23,43 +23,686 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <cstring>
 #include "BnxSeenList.h"
 #include "BnxListIo.h"
 
+namespace {
+	struct TimestampLessThan {
+		bool operator()(const BnxSeenList::SeenInfo &clSeenInfo1, const BnxSeenList::SeenInfo &clSeenInfo2) const {
+			return clSeenInfo1.GetTimestamp() < clSeenInfo2.GetTimestamp();
+		}
+	};
+
+	bool HasCasePrefix(const char *pString, const char *pPrefix, IrcCaseMapping eCaseMapping) {
+		const unsigned char * const pLower = IrcGetLowerTable(eCaseMapping);
+
+		for ( ; *pPrefix != '\0' && pLower[(unsigned char)*pString] == pLower[(unsigned char)*pPrefix]; ++pString, ++pPrefix);
+
+		return *pPrefix == '\0';
+	}
+
+	bool HasCaseSuffix(const char *pString, const char *pSuffix, IrcCaseMapping eCaseMapping) {
+		size_t length = strlen(pString), suffixLength = strlen(pSuffix);
+
+		return length >= suffixLength && HasCasePrefix(pString + length - suffixLength, pSuffix, eCaseMapping);
+	}
+
+	// Compares folded characters as unsigned, back to front if bReverse is set
+	int FoldedCmp(const char *pString1, const char *pString2, IrcCaseMapping eCaseMapping, bool bReverse) {
+		const unsigned char * const pLower = IrcGetLowerTable(eCaseMapping);
+
+		if (!bReverse) {
+			for ( ; *pString1 != '\0' && pLower[(unsigned char)*pString1] == pLower[(unsigned char)*pString2]; ++pString1, ++pString2);
+
+			return pLower[(unsigned char)*pString1] - pLower[(unsigned char)*pString2];
+		}
+
+		const char *p1 = pString1 + strlen(pString1), *p2 = pString2 + strlen(pString2);
+
+		while (p1 != pString1 && p2 != pString2) {
+			int c1 = pLower[(unsigned char)*--p1];
+			int c2 = pLower[(unsigned char)*--p2];
+
+			if (c1 != c2)
+				return c1 - c2;
+		}
+
+		return (p1 != pString1) - (p2 != pString2);
+	}
+} // end namespace
+
+void BnxSeenList::Query::SetPattern(const std::string &strPattern) {
+	Reset();
+
+	m_strPattern = strPattern;
+	m_clMask.Parse(strPattern);
+
+	m_clNicknameGlob.Compile(m_clMask.GetNickname().str());
+	m_clUsernameGlob.Compile(m_clMask.GetUsername().str());
+	m_clHostnameGlob.Compile(m_clMask.GetHostname().str());
+
+	const std::string strNickname = m_clMask.GetNickname().str();
+	const std::string strHostname = m_clMask.GetHostname().str();
+
+	// Prefer a literal nickname prefix, then a literal hostname suffix
+	size_t p = strNickname.find_first_of("*?\\");
+
+	if (p != 0) {
+		m_eMode = MODE_NICKNAME;
+		m_strKey = strNickname.substr(0, p);
+		return;
+	}
+
+	p = strHostname.find_last_of("*?\\");
+
+	if (p == std::string::npos) {
+		m_eMode = MODE_HOSTNAME;
+		m_strKey = strHostname;
+	}
+	else if (p+1 < strHostname.size()) {
+		m_eMode = MODE_HOSTNAME;
+		m_strKey = strHostname.substr(p+1);
+	}
+}
+
+void BnxSeenList::Query::Reset() {
+	m_strPattern.clear();
+	m_clMask.Reset();
+	m_clNicknameGlob.Compile(m_clMask.GetNickname().str());
+	m_clUsernameGlob.Compile(m_clMask.GetUsername().str());
+	m_clHostnameGlob.Compile(m_clMask.GetHostname().str());
+	m_eMode = MODE_SCAN;
+	m_strKey.clear();
+	m_bHasCursor = false;
+	m_strCursor.clear();
+	m_cursorRecord = 0;
+	m_bDone = m_bTruncated = false;
+	m_vResults.clear();
+}
+
+bool BnxSeenList::Find(const std::string &strNickname, SeenInfo &clSeenInfo) const {
+	const char *pNickname = strNickname.c_str();
+	const unsigned int record = m_vTable[FindSlot(pNickname, IrcStrCaseHash(pNickname, ASCII))];
+
+	if (record == NO_RECORD)
+		return false;
+
+	MakeSeenInfo(m_vRecords[record], clSeenInfo);
+
+	return true;
+}
+
+void BnxSeenList::Saw(const IrcUser &clUser, const char *pChannel, time_t timeStamp) {
+	const char *pNickname = clUser.GetNickname().c_str(),
+		*pUsername = clUser.GetUsername().c_str(),
+		*pHostname = clUser.GetHostname().c_str();
+
+	const size_t slot = FindSlot(pNickname, IrcStrCaseHash(pNickname, ASCII));
+	unsigned int record = m_vTable[slot];
+
+	if (record != NO_RECORD) {
+		Record &clRecord = m_vRecords[record];
+
+		// Server times can arrive out of order (e.g. playback), an older sighting doesn't replace a newer one
+		// Same second sightings arrived later, so they count as newer
+		if (timeStamp < clRecord.timeStamp)
+			return;
+
+		Unlink(record);
+
+		// Usually only the timestamp changes, so avoid touching the pools
+		if (IrcStrCaseCmp(m_clUsernames.Get(clRecord.hUsername), pUsername) != 0) {
+			Handle hUsername = m_clUsernames.Intern(pUsername);
+			m_clUsernames.Release(clRecord.hUsername);
+			clRecord.hUsername = hUsername;
+		}
+
+		if (IrcStrCaseCmp(m_clHostnames.Get(clRecord.hHostname), pHostname) != 0) {
+			m_clHostnameIndex.Erase(record);
+
+			Handle hHostname = m_clHostnames.Intern(pHostname);
+			m_clHostnames.Release(clRecord.hHostname);
+			clRecord.hHostname = hHostname;
+
+			m_clHostnameIndex.Insert(record);
+		}
+
+		if (IrcStrCaseCmp(m_clChannels.Get(clRecord.hChannel), pChannel) != 0) {
+			Handle hChannel = m_clChannels.Intern(pChannel);
+			m_clChannels.Release(clRecord.hChannel);
+			clRecord.hChannel = hChannel;
+		}
+
+		clRecord.timeStamp = timeStamp;
+
+		Link(record);
+
+		return;
+	}
+
+	if (m_freeRecord != NO_RECORD) {
+		record = m_freeRecord;
+		m_freeRecord = m_vRecords[record].next;
+	}
+	else {
+		record = (unsigned int)m_vRecords.size();
+		m_vRecords.push_back(Record());
+	}
+
+	Record &clRecord = m_vRecords[record];
+
+	clRecord.hNickname = m_clNicknames.Intern(pNickname);
+	clRecord.hUsername = m_clUsernames.Intern(pUsername);
+	clRecord.hHostname = m_clHostnames.Intern(pHostname);
+	clRecord.hChannel = m_clChannels.Intern(pChannel);
+	clRecord.timeStamp = timeStamp;
+
+	m_vTable[slot] = record;
+
+	if (++m_size*4 > m_vTable.size()*3)
+		Grow();
+
+	Link(record);
+	m_clNicknameIndex.Insert(record);
+	m_clHostnameIndex.Insert(record);
+}
+
+void BnxSeenList::FindRecent(const std::string &strChannel, time_t timeSince, std::vector<SeenInfo> &vSeenInfo) const {
+	vSeenInfo.clear();
+
+	Handle hChannel = m_clChannels.Find(strChannel.c_str());
+
+	if (hChannel == IrcStringPool::INVALID_HANDLE || hChannel >= m_vChannelLists.size())
+		return;
+
+	unsigned int record = m_vChannelLists[hChannel].tail;
+
+	for ( ; record != NO_RECORD && m_vRecords[record].timeStamp > timeSince; record = m_vRecords[record].channelPrev) {
+		vSeenInfo.push_back(SeenInfo());
+		MakeSeenInfo(m_vRecords[record], vSeenInfo.back());
+	}
+}
+
+bool BnxSeenList::Search(Query &clQuery, size_t maxRecords) const {
+	if (clQuery.m_bDone)
+		return true;
+
+	size_t count = 0;
+
+	switch (clQuery.m_eMode) {
+	case Query::MODE_NICKNAME:
+	case Query::MODE_HOSTNAME:
+		{
+			const bool bNickname = (clQuery.m_eMode == Query::MODE_NICKNAME);
+			const RecordIndex &clIndex = bNickname ? m_clNicknameIndex : m_clHostnameIndex;
+			const char *pKey = clQuery.m_strKey.c_str();
+
+			RecordIndex::Position clPosition;
+
+			if (clQuery.m_bHasCursor)
+				clPosition = clIndex.UpperBound(clQuery.m_strCursor.c_str(), clQuery.m_cursorRecord);
+			else
+				clPosition = clIndex.LowerBound(pKey, 0);
+
+			for ( ; !clIndex.IsEnd(clPosition); clIndex.Next(clPosition)) {
+				const unsigned int record = clIndex.Get(clPosition);
+				const Record &clRecord = m_vRecords[record];
+
+				const char *pString = bNickname ? m_clNicknames.Get(clRecord.hNickname) : m_clHostnames.Get(clRecord.hHostname);
+
+				// Matching records are contiguous
+				if (bNickname ? !HasCasePrefix(pString, pKey, m_clNicknames.GetCaseMapping()) : 
+						!HasCaseSuffix(pString, pKey, m_clHostnames.GetCaseMapping())) {
+					break;
+				}
+
+				if (SearchVisit(clQuery, record))
+					return true;
+
+				if (++count >= maxRecords) {
+					clQuery.m_bHasCursor = true;
+					clQuery.m_strCursor = pString;
+					clQuery.m_cursorRecord = record;
+					return false;
+				}
+			}
+		}
+		break;
+	case Query::MODE_SCAN:
+		for (unsigned int record = clQuery.m_bHasCursor ? clQuery.m_cursorRecord+1 : 0; record < m_vRecords.size(); ++record) {
+			if (m_vRecords[record].hNickname != IrcStringPool::INVALID_HANDLE && SearchVisit(clQuery, record))
+				return true;
+
+			if (++count >= maxRecords) {
+				clQuery.m_bHasCursor = true;
+				clQuery.m_cursorRecord = record;
+				return false;
+			}
+		}
+		break;
+	}
+
+	clQuery.m_bDone = true;
+
+	return true;
+}
+
 bool BnxSeenList::Load() {
 	Reset();
 	std::vector<SeenInfo> vSeenInfo;
 	if (!BnxLoadList(GetSeenListFile().c_str(), vSeenInfo))
 		return false;
 
+	// Linking is cheapest in timestamp order
+	std::stable_sort(vSeenInfo.begin(), vSeenInfo.end(), TimestampLessThan());
+
 	for (size_t i = 0; i < vSeenInfo.size(); ++i) {
-		const std::string &strNick = vSeenInfo[i].GetUser().GetNickname();
-		m_mSeenMap[strNick] = vSeenInfo[i];
+		const SeenInfo &clSeenInfo = vSeenInfo[i];
+		Saw(clSeenInfo.GetUser(), clSeenInfo.GetChannel().c_str(), clSeenInfo.GetTimestamp());
 	}
 
 	return true;
 }
 
 void BnxSeenList::Save() const {
-	std::vector<SeenInfo> vSeenInfo;
+	std::vector<SeenInfo> vSeenInfo(m_size);
 
-	for (Iterator itr = Begin(); itr != End(); ++itr)
-		vSeenInfo.push_back(itr->second);
+	size_t i = 0;
+	for (unsigned int record = m_timeList.head; record != NO_RECORD; record = m_vRecords[record].next)
+		MakeSeenInfo(m_vRecords[record], vSeenInfo[i++]);
 
 	BnxSaveList(GetSeenListFile().c_str(), vSeenInfo);
 }
 
+void BnxSeenList::Reset() {
+	ReleaseHostnames();
+
+	m_clNicknames.Reset();
+	m_clUsernames.Reset();
+	m_clChannels.Reset();
+
+	m_vRecords.clear();
+	m_freeRecord = NO_RECORD;
+
+	m_vTable.assign(16, NO_RECORD);
+	m_size = 0;
+
+	m_timeList.head = m_timeList.tail = NO_RECORD;
+	m_vChannelLists.clear();
+
+	m_clNicknameIndex.Clear();
+	m_clHostnameIndex.Clear();
+}
+
+void BnxSeenList::ReleaseHostnames() {
+	// The hostname pool may be shared, so only drop this list's references
+	for (size_t i = 0; i < m_vRecords.size(); ++i) {
+		if (m_vRecords[i].hNickname != IrcStringPool::INVALID_HANDLE)
+			m_clHostnames.Release(m_vRecords[i].hHostname);
+	}
+}
+
 void BnxSeenList::ExpireEntries() {
-	MapType::iterator itr = m_mSeenMap.begin();
+	const time_t expireTime = IrcClock::WallNow() - (EXPIRE_TIME_IN_DAYS*60*60*24);
+
+	const size_t oldSize = m_size;
+
+	// Oldest entries are first, so stop at the first unexpired one
+	while (m_timeList.head != NO_RECORD && m_vRecords[m_timeList.head].timeStamp < expireTime)
+		Remove(m_timeList.head);
+
+	if (m_size == oldSize)
+		return;
+
+	// Drop the removed records from the search indices in one pass
+	m_clNicknameIndex.EraseFree();
+	m_clHostnameIndex.EraseFree();
+}
+
+size_t BnxSeenList::FindSlot(const char *pNickname, unsigned int hash) const {
+	const size_t mask = m_vTable.size()-1;
+
+	// Linear probing, the table is never full
+	for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+		const unsigned int record = m_vTable[slot];
+
+		if (record == NO_RECORD)
+			return slot;
+
+		const Handle hNickname = m_vRecords[record].hNickname;
+
+		if (m_clNicknames.GetHash(hNickname) == hash && !IrcStrCaseCmp(m_clNicknames.Get(hNickname), pNickname))
+			return slot;
+	}
+}
+
+void BnxSeenList::EraseSlot(size_t slot) {
+	const size_t mask = m_vTable.size()-1;
+
+	// Backward shift deletion so that no tombstones are needed
+	size_t next = (slot + 1) & mask;
+
+	for ( ; m_vTable[next] != NO_RECORD; next = (next + 1) & mask) {
+		const size_t home = m_clNicknames.GetHash(m_vRecords[m_vTable[next]].hNickname) & mask;
 
-	while (itr != m_mSeenMap.end()) {
-		if (itr->second.IsExpired()) {
-			m_mSeenMap.erase(itr); // erase() does not return an iterator in standard C++
-			itr = m_mSeenMap.begin();
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			m_vTable[slot] = m_vTable[next];
+			slot = next;
+		}
+	}
+
+	m_vTable[slot] = NO_RECORD;
+}
+
+void BnxSeenList::Grow() {
+	std::vector<unsigned int> vTable(m_vTable.size()*2, NO_RECORD);
+	const size_t mask = vTable.size()-1;
+
+	for (size_t i = 0; i < m_vTable.size(); ++i) {
+		const unsigned int record = m_vTable[i];
+
+		if (record == NO_RECORD)
+			continue;
+
+		size_t slot = m_clNicknames.GetHash(m_vRecords[record].hNickname) & mask;
+
+		for ( ; vTable[slot] != NO_RECORD; slot = (slot + 1) & mask);
+
+		vTable[slot] = record;
+	}
+
+	m_vTable.swap(vTable);
+}
+
+void BnxSeenList::Link(unsigned int record) {
+	const Handle hChannel = m_vRecords[record].hChannel;
+
+	if (hChannel >= m_vChannelLists.size()) {
+		RecordList clEmpty = { NO_RECORD, NO_RECORD };
+		m_vChannelLists.resize(m_clChannels.GetHandleLimit(), clEmpty);
+	}
+
+	LinkInto(m_timeList, record, &Record::prev, &Record::next);
+	LinkInto(m_vChannelLists[hChannel], record, &Record::channelPrev, &Record::channelNext);
+}
+
+void BnxSeenList::Unlink(unsigned int record) {
+	UnlinkFrom(m_timeList, record, &Record::prev, &Record::next);
+	UnlinkFrom(m_vChannelLists[m_vRecords[record].hChannel], record, &Record::channelPrev, &Record::channelNext);
+}
+
+void BnxSeenList::Remove(unsigned int record) {
+	Record &clRecord = m_vRecords[record];
+	const Handle hNickname = clRecord.hNickname;
+	const char *pNickname = m_clNicknames.Get(hNickname);
+
+	Unlink(record);
+	EraseSlot(FindSlot(pNickname, m_clNicknames.GetHash(hNickname)));
+
+	m_clNicknames.Release(clRecord.hNickname);
+	m_clUsernames.Release(clRecord.hUsername);
+	m_clHostnames.Release(clRecord.hHostname);
+	m_clChannels.Release(clRecord.hChannel);
+
+	// Marks the record as free
+	clRecord.hNickname = IrcStringPool::INVALID_HANDLE;
+
+	clRecord.next = m_freeRecord;
+	m_freeRecord = record;
+
+	--m_size;
+}
+
+void BnxSeenList::LinkInto(RecordList &clList, unsigned int record, unsigned int Record::*pPrev, unsigned int Record::*pNext) {
+	Record &clRecord = m_vRecords[record];
+
+	// New timestamps are almost always the latest, so search from the tail
+	unsigned int prev = clList.tail;
+
+	for ( ; prev != NO_RECORD && m_vRecords[prev].timeStamp > clRecord.timeStamp; prev = m_vRecords[prev].*pPrev);
+
+	const unsigned int next = (prev == NO_RECORD) ? clList.head : m_vRecords[prev].*pNext;
+
+	clRecord.*pPrev = prev;
+	clRecord.*pNext = next;
+
+	if (prev == NO_RECORD)
+		clList.head = record;
+	else
+		m_vRecords[prev].*pNext = record;
+
+	if (next == NO_RECORD)
+		clList.tail = record;
+	else
+		m_vRecords[next].*pPrev = record;
+}
+
+void BnxSeenList::UnlinkFrom(RecordList &clList, unsigned int record, unsigned int Record::*pPrev, unsigned int Record::*pNext) {
+	const Record &clRecord = m_vRecords[record];
+	const unsigned int prev = clRecord.*pPrev, next = clRecord.*pNext;
+
+	if (prev == NO_RECORD)
+		clList.head = next;
+	else
+		m_vRecords[prev].*pNext = next;
+
+	if (next == NO_RECORD)
+		clList.tail = prev;
+	else
+		m_vRecords[next].*pPrev = prev;
+}
+
+void BnxSeenList::MakeSeenInfo(const Record &clRecord, SeenInfo &clSeenInfo) const {
+	clSeenInfo.SetUser(IrcUser(m_clNicknames.Get(clRecord.hNickname), 
+					m_clUsernames.Get(clRecord.hUsername), 
+					m_clHostnames.Get(clRecord.hHostname)));
+	clSeenInfo.SetChannel(m_clChannels.Get(clRecord.hChannel));
+	clSeenInfo.SetTimestamp(clRecord.timeStamp);
+}
+
+bool BnxSeenList::SearchVisit(Query &clQuery, unsigned int record) const {
+	const Record &clRecord = m_vRecords[record];
+
+	// The globs are compiled with the pools' case mapping (ASCII)
+	if (!clQuery.m_clHostnameGlob.Matches(m_clHostnames.Get(clRecord.hHostname)) ||
+		!clQuery.m_clNicknameGlob.Matches(m_clNicknames.Get(clRecord.hNickname)) ||
+		!clQuery.m_clUsernameGlob.Matches(m_clUsernames.Get(clRecord.hUsername))) {
+		return false;
+	}
+
+	if (clQuery.m_vResults.size() >= MAX_SEARCH_RESULTS) {
+		clQuery.m_bTruncated = clQuery.m_bDone = true;
+		return true;
+	}
+
+	clQuery.m_vResults.push_back(SeenInfo());
+	MakeSeenInfo(clRecord, clQuery.m_vResults.back());
+
+	return false;
+}
+
+void BnxSeenList::RecordIndex::Insert(unsigned int record) {
+	Entry clEntry;
+	MakeEntry(GetString(record), record, clEntry);
+
+	if (m_vBlocks.empty()) {
+		m_vBlocks.push_back(Block(1, clEntry));
+		m_vLastEntries.push_back(clEntry);
+		return;
+	}
+
+	Position clPosition = Bound(GetString(record), record, false);
+
+	// Past the end goes on the end of the last block
+	if (IsEnd(clPosition)) {
+		clPosition.block = m_vBlocks.size()-1;
+		clPosition.offset = m_vBlocks.back().size();
+	}
+
+	const size_t block = clPosition.block;
+
+	Block &clBlock = m_vBlocks[block];
+	clBlock.insert(clBlock.begin() + clPosition.offset, clEntry);
+
+	if (clBlock.size() <= MAX_BLOCK_SIZE) {
+		m_vLastEntries[block] = clBlock.back();
+		return;
+	}
+
+	// Split in half, swapping blocks down rather than copying them
+	m_vBlocks.push_back(Block());
+
+	for (size_t i = m_vBlocks.size()-1; i > block+1; --i)
+		m_vBlocks[i].swap(m_vBlocks[i-1]);
+
+	Block &clLower = m_vBlocks[block], &clUpper = m_vBlocks[block+1];
+
+	clUpper.assign(clLower.begin() + clLower.size()/2, clLower.end());
+	clLower.resize(clLower.size()/2);
+
+	m_vLastEntries[block] = clLower.back();
+	m_vLastEntries.insert(m_vLastEntries.begin() + block+1, clUpper.back());
+}
+
+void BnxSeenList::RecordIndex::Erase(unsigned int record) {
+	const Position clPosition = LowerBound(GetString(record), record);
+
+	if (IsEnd(clPosition) || Get(clPosition) != record)
+		return;
+
+	Block &clBlock = m_vBlocks[clPosition.block];
+	clBlock.erase(clBlock.begin() + clPosition.offset);
+
+	if (!clBlock.empty()) {
+		m_vLastEntries[clPosition.block] = clBlock.back();
+		return;
+	}
+
+	for (size_t i = clPosition.block; i+1 < m_vBlocks.size(); ++i)
+		m_vBlocks[i].swap(m_vBlocks[i+1]);
+
+	m_vBlocks.pop_back();
+	m_vLastEntries.erase(m_vLastEntries.begin() + clPosition.block);
+}
+
+void BnxSeenList::RecordIndex::EraseFree() {
+	size_t j = 0;
+
+	for (size_t i = 0; i < m_vBlocks.size(); ++i) {
+		Block &clBlock = m_vBlocks[i];
+		size_t size = 0;
+
+		for (size_t k = 0; k < clBlock.size(); ++k) {
+			if (m_vRecords[clBlock[k].record].hNickname != IrcStringPool::INVALID_HANDLE)
+				clBlock[size++] = clBlock[k];
+		}
+
+		clBlock.resize(size);
+
+		if (!clBlock.empty()) {
+			m_vLastEntries[j] = clBlock.back();
+			m_vBlocks[j++].swap(clBlock);
+		}
+	}
+
+	m_vBlocks.resize(j);
+	m_vLastEntries.resize(j);
+}
+
+BnxSeenList::RecordIndex::Position BnxSeenList::RecordIndex::LowerBound(const char *pString, unsigned int record) const {
+	return Bound(pString, record, false);
+}
+
+BnxSeenList::RecordIndex::Position BnxSeenList::RecordIndex::UpperBound(const char *pString, unsigned int record) const {
+	return Bound(pString, record, true);
+}
+
+void BnxSeenList::RecordIndex::MakeEntry(const char *pString, unsigned int record, Entry &clEntry) const {
+	const unsigned char * const pLower = IrcGetLowerTable(m_clPool.GetCaseMapping());
+
+	std::fill(clEntry.prefix, clEntry.prefix + PREFIX_WORDS, 0);
+	clEntry.record = record;
+
+	const char *p = pString, *pEnd = pString + strlen(pString);
+
+	if (m_bReverse)
+		p = pEnd;
+
+	for (int i = 0; i < 4*PREFIX_WORDS; ++i) {
+		if (m_bReverse ? p == pString : p == pEnd)
+			break;
+
+		const unsigned int c = pLower[(unsigned char)(m_bReverse ? *--p : *p++)];
+
+		clEntry.prefix[i/4] |= c << (8*(3 - i%4));
+	}
+}
+
+int BnxSeenList::RecordIndex::Compare(const Entry &clEntry, const char *pString, const Entry &clKey) const {
+	for (int i = 0; i < PREFIX_WORDS; ++i) {
+		if (clEntry.prefix[i] != clKey.prefix[i])
+			return clEntry.prefix[i] < clKey.prefix[i] ? -1 : 1;
+	}
+
+	// Strings shorter than the prefix are settled already
+	if ((clKey.prefix[PREFIX_WORDS-1] & 0xff) != 0) {
+		int iCmp = FoldedCmp(GetString(clEntry.record), pString, m_clPool.GetCaseMapping(), m_bReverse);
+
+		if (iCmp != 0)
+			return iCmp;
+	}
+
+	return clEntry.record < clKey.record ? -1 : (clEntry.record > clKey.record);
+}
+
+size_t BnxSeenList::RecordIndex::FindBlock(const char *pString, const Entry &clKey, bool bUpper) const {
+	size_t first = 0, count = m_vLastEntries.size();
+
+	// First block whose last entry is not before (or is after) the key
+	while (count > 0) {
+		const size_t step = count/2, mid = first + step;
+		const int iCmp = Compare(m_vLastEntries[mid], pString, clKey);
+
+		if (iCmp < 0 || (bUpper && iCmp == 0)) {
+			first = mid + 1;
+			count -= step + 1;
 		}
 		else {
-			++itr;
+			count = step;
 		}
 	}
+
+	return first;
 }
 
+BnxSeenList::RecordIndex::Position BnxSeenList::RecordIndex::Bound(const char *pString, unsigned int record, bool bUpper) const {
+	Entry clKey;
+	MakeEntry(pString, record, clKey);
+
+	Position clPosition;
+	clPosition.block = FindBlock(pString, clKey, bUpper);
+	clPosition.offset = 0;
+
+	if (IsEnd(clPosition))
+		return clPosition;
+
+	const Block &clBlock = m_vBlocks[clPosition.block];
+	size_t count = clBlock.size();
+
+	while (count > 0) {
+		const size_t step = count/2, mid = clPosition.offset + step;
+		const int iCmp = Compare(clBlock[mid], pString, clKey);
+
+		if (iCmp < 0 || (bUpper && iCmp == 0)) {
+			clPosition.offset = mid + 1;
+			count -= step + 1;
+		}
+		else {
+			count = step;
+		}
+	}
+
+	return clPosition;
+}
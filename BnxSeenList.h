@@ -29,13 +29,16 @@
 #include <ctime>
 #include <iostream>
 #include <string>
-#include <map>
+#include <vector>
 #include "IrcUser.h"
+#include "IrcClock.h"
+#include "IrcGlob.h"
 #include "IrcString.h"
+#include "IrcStringPool.h"
 
 class BnxSeenList {
 public:
-	enum { EXPIRE_TIME_IN_DAYS = 90 };
+	enum { EXPIRE_TIME_IN_DAYS = 90, MAX_SEARCH_RESULTS = 10, SEARCH_SLICE_SIZE = 10000 };
 
 	class SeenInfo {
 	public:
@@ -75,11 +78,11 @@ public:
 		}
 
 		bool IsExpired() const {
-			return (time(NULL)-m_timeStamp) > (EXPIRE_TIME_IN_DAYS*60*60*24);
+			return (IrcClock::WallNow()-m_timeStamp) > (EXPIRE_TIME_IN_DAYS*60*60*24);
 		}
 
 		void Update() {
-			time(&m_timeStamp);
+			m_timeStamp = IrcClock::WallNow();
 		}
 
 		void Reset() {
@@ -89,10 +92,7 @@ public:
 		}
 
 		bool operator==(const SeenInfo &clSeenInfo) const {
-			const std::string &strNickname1 = GetUser().GetNickname();
-			const std::string &strNickname2 = clSeenInfo.GetUser().GetNickname();
-
-			return !IrcStrCaseCmp(strNickname1.c_str(), strNickname2.c_str());
+			return !IrcStrCaseCmp(GetUser().GetNickname().c_str(), clSeenInfo.GetUser().GetNickname().c_str());
 		}
 
 	private:
@@ -101,17 +101,82 @@ public:
 		time_t m_timeStamp;
 	};
 
-	struct StringLessThan {
-		bool operator()(const std::string &strString1, const std::string &strString2) const {
-			return IrcStrCaseCmp(strString1.c_str(), strString2.c_str()) < 0;
+	// Wildcard search state, run incrementally with Search()
+	class Query {
+	public:
+		Query() {
+			Reset();
+		}
+
+		explicit Query(const std::string &strPattern) {
+			Reset();
+			SetPattern(strPattern);
+		}
+
+		void SetPattern(const std::string &strPattern);
+
+		const std::string & GetPattern() const {
+			return m_strPattern;
+		}
+
+		const std::vector<SeenInfo> & GetResults() const {
+			return m_vResults;
+		}
+
+		bool IsDone() const {
+			return m_bDone;
+		}
+
+		// More matches than MAX_SEARCH_RESULTS
+		bool IsTruncated() const {
+			return m_bTruncated;
 		}
+
+		void Reset();
+
+	private:
+		friend class BnxSeenList;
+
+		enum ModeType { MODE_NICKNAME = 0, MODE_HOSTNAME, MODE_SCAN };
+
+		std::string m_strPattern;
+		IrcUser m_clMask;
+		IrcGlob m_clNicknameGlob, m_clUsernameGlob, m_clHostnameGlob;
+		ModeType m_eMode;
+
+		// Literal nickname prefix or hostname suffix
+		std::string m_strKey;
+
+		// Where the previous slice stopped
+		bool m_bHasCursor;
+		std::string m_strCursor;
+		unsigned int m_cursorRecord;
+
+		bool m_bDone, m_bTruncated;
+		std::vector<SeenInfo> m_vResults;
 	};
 
-	typedef std::map<std::string, SeenInfo, StringLessThan> MapType;
-	typedef MapType::const_iterator Iterator;
+	BnxSeenList()
+	: m_clNicknames(ASCII), m_clUsernames(ASCII), m_clChannels(ASCII), m_clOwnHostnames(ASCII),
+	m_clHostnames(m_clOwnHostnames),
+	m_clNicknameIndex(m_vRecords, m_clNicknames, &Record::hNickname, false),
+	m_clHostnameIndex(m_vRecords, m_clHostnames, &Record::hHostname, true) {
+		m_strSeenListFile = "seen.lst";
+		Reset();
+	}
 
-	BnxSeenList() {
+	// Hostnames are interned in an ASCII pool shared with others, which must outlive the list
+	explicit BnxSeenList(IrcStringPool &clHostnames)
+	: m_clNicknames(ASCII), m_clUsernames(ASCII), m_clChannels(ASCII), m_clOwnHostnames(ASCII),
+	m_clHostnames(clHostnames),
+	m_clNicknameIndex(m_vRecords, m_clNicknames, &Record::hNickname, false),
+	m_clHostnameIndex(m_vRecords, m_clHostnames, &Record::hHostname, true) {
 		m_strSeenListFile = "seen.lst";
+		Reset();
+	}
+
+	~BnxSeenList() {
+		ReleaseHostnames();
 	}
 
 	void SetSeenListFile(const std::string &strSeenListFile) {
@@ -122,35 +187,167 @@ public:
 		return m_strSeenListFile;
 	}
 
-	Iterator Begin() const {
-		return m_mSeenMap.begin();
+	size_t GetSize() const {
+		return m_size;
 	}
 
-	Iterator End() const {
-		return m_mSeenMap.end();
-	}
+	bool Find(const std::string &strNickname, SeenInfo &clSeenInfo) const;
 
-	Iterator Find(const std::string &strNickname) const {
-		return m_mSeenMap.find(strNickname);
+	void Saw(const IrcUser &clUser, const char *pChannel) {
+		Saw(clUser, pChannel, IrcClock::WallNow());
 	}
 
-	void Saw(const IrcUser &clUser, const std::string &strChannel) {
-		m_mSeenMap[clUser.GetNickname()] = SeenInfo(clUser, strChannel);
-	}
+	// Ignored if the nickname was already seen later than timeStamp
+	void Saw(const IrcUser &clUser, const char *pChannel, time_t timeStamp);
+
+	// Most recent first, only entries seen after timeSince
+	void FindRecent(const std::string &strChannel, time_t timeSince, std::vector<SeenInfo> &vSeenInfo) const;
+
+	// Examines at most maxRecords entries, returns true when the query is done
+	bool Search(Query &clQuery, size_t maxRecords = SEARCH_SLICE_SIZE) const;
 
 	bool Load();
 
 	void Save() const;
 
-	void Reset() {
-		m_mSeenMap.clear();
-	}
+	void Reset();
 
 	void ExpireEntries();
 
 private:
+	enum { NO_RECORD = 0xffffffff };
+
+	typedef IrcStringPool::Handle Handle;
+
+	// Entries are linked in timestamp order both globally and per channel
+	struct Record {
+		Handle hNickname, hUsername, hHostname, hChannel;
+		time_t timeStamp;
+		unsigned int prev, next, channelPrev, channelNext;
+	};
+
+	struct RecordList {
+		unsigned int head, tail;
+	};
+
+	// Records sorted on a folded string (compared back to front for hostnames), ties broken by record
+	// Kept in small sorted blocks so insertion never shifts the whole index
+	class RecordIndex {
+	public:
+		struct Position {
+			size_t block, offset;
+		};
+
+		RecordIndex(const std::vector<Record> &vRecords, const IrcStringPool &clPool, Handle Record::*pHandle, bool bReverse)
+		: m_vRecords(vRecords), m_clPool(clPool), m_pHandle(pHandle), m_bReverse(bReverse) { }
+
+		void Insert(unsigned int record);
+
+		// NOTE: Call before the record's string changes
+		void Erase(unsigned int record);
+
+		// Drops records whose nickname handle is INVALID_HANDLE
+		void EraseFree();
+
+		void Clear() {
+			m_vBlocks.clear();
+			m_vLastEntries.clear();
+		}
+
+		// First position not before (pString, record)
+		Position LowerBound(const char *pString, unsigned int record) const;
+
+		// First position after (pString, record)
+		Position UpperBound(const char *pString, unsigned int record) const;
+
+		bool IsEnd(const Position &clPosition) const {
+			return clPosition.block >= m_vBlocks.size();
+		}
+
+		unsigned int Get(const Position &clPosition) const {
+			return m_vBlocks[clPosition.block][clPosition.offset].record;
+		}
+
+		void Next(Position &clPosition) const {
+			if (++clPosition.offset >= m_vBlocks[clPosition.block].size()) {
+				++clPosition.block;
+				clPosition.offset = 0;
+			}
+		}
+
+	private:
+		enum { MAX_BLOCK_SIZE = 256, PREFIX_WORDS = 3 };
+
+		// The first 12 folded characters, packed most significant first, settle most comparisons
+		struct Entry {
+			unsigned int prefix[PREFIX_WORDS];
+			unsigned int record;
+		};
+
+		typedef std::vector<Entry> Block;
+
+		const std::vector<Record> &m_vRecords;
+		const IrcStringPool &m_clPool;
+		Handle Record::*m_pHandle;
+		bool m_bReverse;
+
+		std::vector<Block> m_vBlocks;
+
+		// Last entry of each block, searched before touching any block
+		std::vector<Entry> m_vLastEntries;
+
+		const char * GetString(unsigned int record) const {
+			return m_clPool.Get(m_vRecords[record].*m_pHandle);
+		}
+
+		void MakeEntry(const char *pString, unsigned int record, Entry &clEntry) const;
+		int Compare(const Entry &clEntry, const char *pString, const Entry &clKey) const;
+		size_t FindBlock(const char *pString, const Entry &clKey, bool bUpper) const;
+		Position Bound(const char *pString, unsigned int record, bool bUpper) const;
+	};
+
 	std::string m_strSeenListFile;
-	MapType m_mSeenMap;
+
+	IrcStringPool m_clNicknames, m_clUsernames, m_clChannels, m_clOwnHostnames;
+
+	// m_clOwnHostnames unless a shared pool was given
+	IrcStringPool &m_clHostnames;
+
+	std::vector<Record> m_vRecords;
+	unsigned int m_freeRecord;
+
+	// Open addressing (linear probing) on the folded nickname hash
+	std::vector<unsigned int> m_vTable;
+	size_t m_size;
+
+	RecordList m_timeList;
+
+	// Indexed by channel handle
+	std::vector<RecordList> m_vChannelLists;
+
+	// For wildcard searches
+	RecordIndex m_clNicknameIndex, m_clHostnameIndex;
+
+	size_t FindSlot(const char *pNickname, unsigned int hash) const;
+	void EraseSlot(size_t slot);
+	void Grow();
+
+	void Link(unsigned int record);
+	void Unlink(unsigned int record);
+	void Remove(unsigned int record);
+
+	void LinkInto(RecordList &clList, unsigned int record, unsigned int Record::*pPrev, unsigned int Record::*pNext);
+	void UnlinkFrom(RecordList &clList, unsigned int record, unsigned int Record::*pPrev, unsigned int Record::*pNext);
+
+	void MakeSeenInfo(const Record &clRecord, SeenInfo &clSeenInfo) const;
+
+	void ReleaseHostnames();
+
+	bool SearchVisit(Query &clQuery, unsigned int record) const;
+
+	// The indices refer to this object's records and pools
+	BnxSeenList(const BnxSeenList &);
+	BnxSeenList & operator=(const BnxSeenList &);
 };
 
 inline std::ostream & operator<<(std::ostream &os, const BnxSeenList::SeenInfo &clSeenInfo) {
@@ -0,0 +1,107 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BNXSHAREDPTR_H
+#define BNXSHAREDPTR_H
+
+#include <cstddef>
+
+// Reference counted pointer, the object is deleted with the last copy
+// NOTE: The count isn't atomic, copies must stay on one thread (like everything on the event loop)
+
+template<typename T>
+class BnxSharedPtr {
+public:
+	BnxSharedPtr()
+	: m_pObject(NULL), m_pCount(NULL) { }
+
+	explicit BnxSharedPtr(T *pObject)
+	: m_pObject(pObject), m_pCount(pObject != NULL ? new size_t(1) : NULL) { }
+
+	BnxSharedPtr(const BnxSharedPtr &clPtr)
+	: m_pObject(clPtr.m_pObject), m_pCount(clPtr.m_pCount) {
+		if (m_pCount != NULL)
+			++*m_pCount;
+	}
+
+	~BnxSharedPtr() {
+		Reset();
+	}
+
+	T * Get() const {
+		return m_pObject;
+	}
+
+	T & operator*() const {
+		return *m_pObject;
+	}
+
+	T * operator->() const {
+		return m_pObject;
+	}
+
+	bool IsNull() const {
+		return m_pObject == NULL;
+	}
+
+	size_t GetUseCount() const {
+		return m_pCount != NULL ? *m_pCount : 0;
+	}
+
+	void Reset() {
+		if (m_pCount != NULL && --*m_pCount == 0) {
+			delete m_pObject;
+			delete m_pCount;
+		}
+
+		m_pObject = NULL;
+		m_pCount = NULL;
+	}
+
+	void Swap(BnxSharedPtr &clPtr) {
+		T * const pObject = m_pObject;
+		size_t * const pCount = m_pCount;
+
+		m_pObject = clPtr.m_pObject;
+		m_pCount = clPtr.m_pCount;
+
+		clPtr.m_pObject = pObject;
+		clPtr.m_pCount = pCount;
+	}
+
+	BnxSharedPtr & operator=(const BnxSharedPtr &clPtr) {
+		// Copy first in case clPtr is only kept alive by this
+		BnxSharedPtr clCopy(clPtr);
+		Swap(clCopy);
+
+		return *this;
+	}
+
+private:
+	T *m_pObject;
+	size_t *m_pCount;
+};
+
+#endif // !BNXSHAREDPTR_H
@@ -30,6 +30,7 @@
 bool BnxShitList::AddMask(const IrcUser &clMask) {
 	if (GetMask(clMask) == End())  {
 		m_vHostmasks.push_back(clMask);
+		m_clIndex.Insert(clMask);
 		return true;
 	}
 
@@ -47,3 +48,9 @@ bool BnxShitList::DeleteMask(const IrcUser &clMask) {
 	return false;
 }
 
+void BnxShitList::Rebuild() {
+	m_clIndex.Reset();
+
+	for (size_t i = 0; i < m_vHostmasks.size(); ++i)
+		m_clIndex.Insert(m_vHostmasks[i]);
+}
@@ -30,8 +30,10 @@
 #include <vector>
 #include <string>
 #include "IrcUser.h"
+#include "IrcMaskIndex.h"
 #include "BnxListIo.h"
 
+// NOTE: Masks are indexed, do not modify them through an Iterator
 class BnxShitList {
 public:
 	typedef std::vector<IrcUser>::iterator Iterator;
@@ -66,7 +68,9 @@ public:
 
 	bool Load() {
 		Reset();
-		return BnxLoadList(m_strShitListFile.c_str(), m_vHostmasks);
+		const bool bRet = BnxLoadList(m_strShitListFile.c_str(), m_vHostmasks);
+		Rebuild();
+		return bRet;
 	}
 
 	void Save() const {
@@ -77,6 +81,7 @@ public:
 	bool DeleteMask(const IrcUser &clMask);
 
 	Iterator DeleteMask(Iterator maskItr) {
+		m_clIndex.Delete((unsigned int)(maskItr - Begin()));
 		return m_vHostmasks.erase(maskItr);
 	}
 
@@ -88,32 +93,28 @@ public:
 		return std::find(Begin(), End(), clMask);
 	}
 
+	// The first matching mask, as a linear scan would find it
 	Iterator FindMatch(const IrcUser &clUser) {
-		return std::find_if(Begin(), End(), MaskMatches(clUser));
+		const unsigned int mask = m_clIndex.FindMatch(clUser);
+		return mask != IrcMaskIndex::NO_MATCH ? Begin() + mask : End();
 	}
 
 	ConstIterator FindMatch(const IrcUser &clUser) const {
-		return std::find_if(Begin(), End(), MaskMatches(clUser));
+		const unsigned int mask = m_clIndex.FindMatch(clUser);
+		return mask != IrcMaskIndex::NO_MATCH ? Begin() + mask : End();
 	}
 
 	void Reset() {
 		m_vHostmasks.clear();
+		m_clIndex.Reset();
 	}
 
 private:
-	struct MaskMatches {
-		MaskMatches(const IrcUser &clUser_)
-		: clUser(clUser_) { }
-
-		bool operator()(const IrcUser &clMask) const {
-			return clMask.Matches(clUser);
-		}
-
-		const IrcUser &clUser;
-	};
-
 	std::string m_strShitListFile;
 	std::vector<IrcUser> m_vHostmasks;
+	IrcMaskIndex m_clIndex;
+
+	void Rebuild();
 };
 
 #endif // !BNXSHITLIST_H
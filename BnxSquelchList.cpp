@@ -0,0 +1,278 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include "BnxSquelchList.h"
+#include "IrcAddress.h"
+
+void BnxSquelchList::Squelch(const IrcUser &clMask, time_t ttl, time_t now) {
+	const time_t expireTime = ttl > 0 ? now + ttl : 0;
+
+	unsigned int entry = Find(clMask);
+
+	if (entry != NO_ENTRY) {
+		Entry &clEntry = m_vEntries[entry];
+
+		if (clEntry.expireTime != 0 && (expireTime == 0 || expireTime > clEntry.expireTime)) {
+			clEntry.expireTime = expireTime;
+			Schedule(entry);
+		}
+
+		Touch(entry);
+		return;
+	}
+
+	if (m_size >= m_maxSize)
+		Remove(m_tail);
+
+	if (m_freeEntry != NO_ENTRY) {
+		entry = m_freeEntry;
+		m_freeEntry = m_vEntries[entry].next;
+	}
+	else {
+		entry = (unsigned int)m_vEntries.size();
+		m_vEntries.push_back(Entry());
+	}
+
+	Entry &clEntry = m_vEntries[entry];
+
+	clEntry.clMask = clMask;
+	clEntry.hHostname = IrcStringPool::INVALID_HANDLE;
+	clEntry.expireTime = expireTime;
+	clEntry.bUsed = true;
+
+	if (IsExact(clMask)) {
+		clEntry.hHostname = m_clHostnames.Intern(clMask.GetHostname().c_str());
+
+		if (m_vExactEntries.size() < m_clHostnames.GetHandleLimit())
+			m_vExactEntries.resize(m_clHostnames.GetHandleLimit(), NO_ENTRY);
+
+		m_vExactEntries[clEntry.hHostname] = entry;
+	}
+	else {
+		clEntry.clMatcher.Compile(clMask);
+		m_vGlobEntries.push_back(entry);
+	}
+
+	Link(entry);
+	Schedule(entry);
+
+	++m_size;
+}
+
+bool BnxSquelchList::Unsquelch(const IrcUser &clMask) {
+	const unsigned int entry = Find(clMask);
+
+	if (entry == NO_ENTRY)
+		return false;
+
+	Remove(entry);
+
+	return true;
+}
+
+bool BnxSquelchList::IsSquelched(const IrcUser &clUser, time_t now) {
+	const unsigned int entry = FindExact(clUser.GetHostname().c_str());
+
+	// Entries past their expiry wait for ExpireEntries() but no longer count
+	if (entry != NO_ENTRY) {
+		const time_t expireTime = m_vEntries[entry].expireTime;
+
+		if (expireTime == 0 || expireTime > now) {
+			Touch(entry);
+			return true;
+		}
+	}
+
+	for (size_t i = 0; i < m_vGlobEntries.size(); ++i) {
+		const unsigned int entry = m_vGlobEntries[i];
+		const Entry &clEntry = m_vEntries[entry];
+
+		if ((clEntry.expireTime == 0 || clEntry.expireTime > now) && clEntry.clMatcher.Matches(clUser)) {
+			Touch(entry);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BnxSquelchList::ExpireEntries(time_t now) {
+	const time_t tick = now / WHEEL_RESOLUTION;
+
+	// The current slot is visited again next time since it may hold later expiries
+	time_t firstTick = m_nextTick;
+
+	if (tick - firstTick >= WHEEL_SLOTS)
+		firstTick = tick - WHEEL_SLOTS + 1;
+
+	for (time_t t = firstTick; t <= tick; ++t) {
+		std::vector<Timer> &vSlot = m_vWheel[t % WHEEL_SLOTS];
+
+		size_t i = 0;
+
+		while (i < vSlot.size()) {
+			const Timer clTimer = vSlot[i];
+			const Entry &clEntry = m_vEntries[clTimer.entry];
+
+			if (clEntry.bUsed && clEntry.expireTime == clTimer.expireTime && clTimer.expireTime > now) {
+				++i; // Due on a later turn of the wheel
+				continue;
+			}
+
+			if (clEntry.bUsed && clEntry.expireTime == clTimer.expireTime)
+				Remove(clTimer.entry);
+
+			vSlot[i] = vSlot.back();
+			vSlot.pop_back();
+		}
+	}
+
+	m_nextTick = tick;
+}
+
+void BnxSquelchList::Reset() {
+	ReleaseHostnames();
+
+	m_vEntries.clear();
+	m_vExactEntries.clear();
+	m_vGlobEntries.clear();
+	m_vWheel.assign(WHEEL_SLOTS, std::vector<Timer>());
+	m_freeEntry = m_head = m_tail = NO_ENTRY;
+	m_size = 0;
+	m_nextTick = IrcClock::Now() / WHEEL_RESOLUTION;
+}
+
+bool BnxSquelchList::IsExact(const IrcUser &clMask) {
+	const char * const pHostname = clMask.GetHostname().c_str();
+	IrcAddress clPrefix;
+	unsigned int prefixLength = 0;
+
+	return clMask.GetNickname() == "*" && clMask.GetUsername() == "*" &&
+		strpbrk(pHostname, "*?\\") == NULL &&
+		!clPrefix.ParseCidr(pHostname, prefixLength);
+}
+
+unsigned int BnxSquelchList::Find(const IrcUser &clMask) const {
+	if (IsExact(clMask))
+		return FindExact(clMask.GetHostname().c_str());
+
+	for (size_t i = 0; i < m_vGlobEntries.size(); ++i) {
+		if (m_vEntries[m_vGlobEntries[i]].clMask == clMask)
+			return m_vGlobEntries[i];
+	}
+
+	return NO_ENTRY;
+}
+
+void BnxSquelchList::ReleaseHostnames() {
+	// The hostname pool may be shared, so only drop this list's references
+	for (size_t i = 0; i < m_vEntries.size(); ++i) {
+		if (m_vEntries[i].bUsed && m_vEntries[i].hHostname != IrcStringPool::INVALID_HANDLE)
+			m_clHostnames.Release(m_vEntries[i].hHostname);
+	}
+}
+
+unsigned int BnxSquelchList::FindExact(const char *pHostname) const {
+	const IrcStringPool::Handle hHostname = m_clHostnames.Find(pHostname);
+
+	// A shared pool holds hostnames that were never squelched
+	if (hHostname == IrcStringPool::INVALID_HANDLE || hHostname >= m_vExactEntries.size())
+		return NO_ENTRY;
+
+	return m_vExactEntries[hHostname];
+}
+
+void BnxSquelchList::Remove(unsigned int entry) {
+	Entry &clEntry = m_vEntries[entry];
+
+	if (clEntry.hHostname != IrcStringPool::INVALID_HANDLE) {
+		m_vExactEntries[clEntry.hHostname] = NO_ENTRY;
+		m_clHostnames.Release(clEntry.hHostname);
+	}
+	else {
+		m_vGlobEntries.erase(std::find(m_vGlobEntries.begin(), m_vGlobEntries.end(), entry));
+	}
+
+	Unlink(entry);
+
+	// Timers still on the wheel are dropped when their slot comes up
+	clEntry.clMask.Reset();
+	clEntry.bUsed = false;
+	clEntry.next = m_freeEntry;
+	m_freeEntry = entry;
+
+	--m_size;
+}
+
+void BnxSquelchList::Touch(unsigned int entry) {
+	if (entry == m_head)
+		return;
+
+	Unlink(entry);
+	Link(entry);
+}
+
+void BnxSquelchList::Link(unsigned int entry) {
+	Entry &clEntry = m_vEntries[entry];
+
+	clEntry.prev = NO_ENTRY;
+	clEntry.next = m_head;
+
+	if (m_head != NO_ENTRY)
+		m_vEntries[m_head].prev = entry;
+	else
+		m_tail = entry;
+
+	m_head = entry;
+}
+
+void BnxSquelchList::Unlink(unsigned int entry) {
+	Entry &clEntry = m_vEntries[entry];
+
+	if (clEntry.prev != NO_ENTRY)
+		m_vEntries[clEntry.prev].next = clEntry.next;
+	else
+		m_head = clEntry.next;
+
+	if (clEntry.next != NO_ENTRY)
+		m_vEntries[clEntry.next].prev = clEntry.prev;
+	else
+		m_tail = clEntry.prev;
+}
+
+void BnxSquelchList::Schedule(unsigned int entry) {
+	const time_t expireTime = m_vEntries[entry].expireTime;
+
+	if (expireTime == 0)
+		return;
+
+	Timer clTimer;
+	clTimer.entry = entry;
+	clTimer.expireTime = expireTime;
+
+	m_vWheel[(expireTime / WHEEL_RESOLUTION) % WHEEL_SLOTS].push_back(clTimer);
+}
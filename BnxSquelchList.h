@@ -0,0 +1,149 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef BNXSQUELCHLIST_H
+#define BNXSQUELCHLIST_H
+
+#include <ctime>
+#include <vector>
+#include "IrcUser.h"
+#include "IrcClock.h"
+#include "IrcMask.h"
+#include "IrcStringPool.h"
+
+// Squelched hostmasks, each with an optional time to live
+// Exact *!*@host masks are hashed on the hostname, other masks are matched one by one
+// When the list is full, the least recently matched or added mask is evicted
+
+class BnxSquelchList {
+public:
+	enum { DEFAULT_MAX_SIZE = 1024 };
+
+	BnxSquelchList()
+	: m_clOwnHostnames(ASCII), m_clHostnames(m_clOwnHostnames) {
+		m_maxSize = DEFAULT_MAX_SIZE;
+		Reset();
+	}
+
+	// Hostnames are interned in an ASCII pool shared with others, which must outlive the list
+	explicit BnxSquelchList(IrcStringPool &clHostnames)
+	: m_clOwnHostnames(ASCII), m_clHostnames(clHostnames) {
+		m_maxSize = DEFAULT_MAX_SIZE;
+		Reset();
+	}
+
+	~BnxSquelchList() {
+		ReleaseHostnames();
+	}
+
+	void SetMaxSize(size_t maxSize) {
+		m_maxSize = maxSize > 0 ? maxSize : 1;
+	}
+
+	size_t GetMaxSize() const {
+		return m_maxSize;
+	}
+
+	size_t GetSize() const {
+		return m_size;
+	}
+
+	// A ttl of 0 never expires, squelching a mask again keeps the later expiry
+	void Squelch(const IrcUser &clMask, time_t ttl = 0) {
+		Squelch(clMask, ttl, IrcClock::Now());
+	}
+
+	void Squelch(const IrcUser &clMask, time_t ttl, time_t now);
+
+	bool Unsquelch(const IrcUser &clMask);
+
+	bool IsSquelched(const IrcUser &clUser) {
+		return IsSquelched(clUser, IrcClock::Now());
+	}
+
+	bool IsSquelched(const IrcUser &clUser, time_t now);
+
+	void ExpireEntries() {
+		ExpireEntries(IrcClock::Now());
+	}
+
+	void ExpireEntries(time_t now);
+
+	void Reset();
+
+private:
+	// The wheel covers WHEEL_SLOTS*WHEEL_RESOLUTION seconds, later expiries wait extra turns
+	enum { NO_ENTRY = 0xffffffff, WHEEL_SLOTS = 256, WHEEL_RESOLUTION = 16 };
+
+	struct Entry {
+		IrcUser clMask;
+		IrcMask clMatcher; // Compiled clMask for glob masks
+		IrcStringPool::Handle hHostname; // INVALID_HANDLE for glob masks
+		time_t expireTime; // 0 never expires
+		unsigned int prev, next; // LRU order, next also links free entries
+		bool bUsed;
+	};
+
+	// Stale once the entry's expiry changes
+	struct Timer {
+		unsigned int entry;
+		time_t expireTime;
+	};
+
+	IrcStringPool m_clOwnHostnames;
+
+	// m_clOwnHostnames unless a shared pool was given
+	IrcStringPool &m_clHostnames;
+
+	std::vector<Entry> m_vEntries;
+	unsigned int m_freeEntry, m_head, m_tail;
+	size_t m_size, m_maxSize;
+
+	// Indexed by hostname handle
+	std::vector<unsigned int> m_vExactEntries;
+
+	// Glob and CIDR masks
+	std::vector<unsigned int> m_vGlobEntries;
+
+	// The hostname pool is held by reference
+	BnxSquelchList(const BnxSquelchList &);
+	BnxSquelchList & operator=(const BnxSquelchList &);
+
+	std::vector<std::vector<Timer> > m_vWheel;
+	time_t m_nextTick;
+
+	static bool IsExact(const IrcUser &clMask);
+
+	unsigned int Find(const IrcUser &clMask) const;
+	unsigned int FindExact(const char *pHostname) const;
+	void ReleaseHostnames();
+	void Remove(unsigned int entry);
+	void Touch(unsigned int entry);
+	void Link(unsigned int entry);
+	void Unlink(unsigned int entry);
+	void Schedule(unsigned int entry);
+};
+
+#endif // !BNXSQUELCHLIST_H
@@ -147,10 +147,10 @@ bool CtcpDecoder::Decode(CtcpMessage &message) {
 	message.tag = message.data = NULL;
 	message.tagSize = message.dataSize = 0;
 
-	if (m_aBuffer[m_offset] == '\0')
+	if (m_pBuffer[m_offset] == '\0')
 		return false;
 
-	char *pBegin = m_aBuffer + m_offset, *pEnd;
+	char *pBegin = m_pBuffer + m_offset, *pEnd;
 
 	for (pEnd = pBegin; *pEnd != 0001 && *pEnd != '\0'; ++pEnd);
 
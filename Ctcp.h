@@ -63,6 +63,27 @@ inline CtcpMessage MakeCtcpMessage(const char *pTag, const char *pData) {
 	return message;
 }
 
+// The first non-empty piece of a message decides whether it is CTCP, so plain text is told apart by its first bytes
+// Returns the \001 opening the first non-empty piece when that piece is tagged, otherwise NULL
+// NOTE: Tags must start with an unquoted character
+inline char * CtcpFindTagged(char *pRaw) {
+	while (pRaw[0] == 0001 && pRaw[1] == 0001)
+		pRaw += 2;
+
+	if (pRaw[0] != 0001)
+		return NULL;
+
+	switch (pRaw[1]) {
+	case '\0':
+	case 0020:
+	case 0040:
+	case 0134:
+		return NULL;
+	}
+
+	return pRaw;
+}
+
 class CtcpEncoder {
 public:
 	enum { MESSAGE_SIZE = 510 };
@@ -109,6 +130,7 @@ public:
 
 	void Reset() {
 		m_aBuffer[0] = '\0';
+		m_pBuffer = m_aBuffer;
 		m_offset = 0;
 		m_iTag = 0;
 	}
@@ -126,8 +148,15 @@ public:
 		return true;
 	}
 
+	// Decodes pRaw in place without copying it, NOTE: pRaw is overwritten and must outlive the decoder
+	void SetBuffer(char *pRaw) {
+		Reset();
+		m_pBuffer = pRaw;
+	}
+
 private:
 	char m_aBuffer[MESSAGE_SIZE+1];
+	char *m_pBuffer;
 	size_t m_offset;
 	int m_iTag;
 
@@ -31,21 +31,15 @@
 #include <map>
 
 // For portable caseless compare
-#include "IrcString.h"
+#include "IrcKey.h"
 
 // Implement own INI parser since iniparser considers '#' a comment!
 
 class IniFile {
 public:
-	struct StringLessThan {
-		bool operator()(const std::string &strString1, const std::string &strString2) const {
-			return IrcStrCaseCmp(strString1.c_str(), strString2.c_str()) < 0;
-		}
-	};
-
 	class Section {
 	public:
-		typedef std::map<std::string, std::string, StringLessThan> MapType;
+		typedef std::map<IrcKey, std::string> MapType;
 		typedef MapType::iterator KeyIterator;
 		typedef MapType::const_iterator ConstKeyIterator;
 
@@ -90,10 +84,10 @@ public:
 
 	private:
 		std::string m_strName;
-		std::map<std::string, std::string, StringLessThan> m_mValueMap;
+		MapType m_mValueMap;
 	};
 
-	typedef std::map<std::string, Section, StringLessThan> MapType;
+	typedef std::map<IrcKey, Section> MapType;
 	typedef MapType::iterator SectionIterator;
 	typedef MapType::const_iterator ConstSectionIterator;
 
@@ -122,12 +116,12 @@ public:
 	bool Load(const std::string &strFilename);
 
 	bool HasSection(const std::string &strSection) const {
-		return m_mSectionMap.find(strSection) != SectionEnd();
+		return m_mSectionMap.find(IrcKey(strSection)) != SectionEnd();
 	}
 
 	Section & GetSection(const std::string &strSection) {
 		// Will do insert automatically
-		return m_mSectionMap[strSection];
+		return m_mSectionMap[IrcKey(strSection)];
 	}
 
 	void Clear() {
@@ -142,7 +136,7 @@ private:
 
 template<typename T>
 T IniFile::Section::GetValue(const std::string &strKey, const T &defaultValue) const {
-	ConstKeyIterator itr = m_mValueMap.find(strKey);
+	ConstKeyIterator itr = m_mValueMap.find(IrcKey(strKey));
 
 	if (itr != KeyEnd()) {
 		std::stringstream valueStream;
@@ -157,7 +151,7 @@ T IniFile::Section::GetValue(const std::string &strKey, const T &defaultValue) c
 
 template<>
 inline std::string IniFile::Section::GetValue<std::string>(const std::string &strKey, const std::string &strDefault) const {
-	ConstKeyIterator itr = m_mValueMap.find(strKey);
+	ConstKeyIterator itr = m_mValueMap.find(IrcKey(strKey));
 
 	return itr != KeyEnd() ? itr->second : strDefault;
 }
@@ -168,12 +162,12 @@ void IniFile::Section::SetValue(const std::string &strKey, const T &value) {
 
 	valueStream << value;
 
-	m_mValueMap[strKey] = valueStream.str();
+	m_mValueMap[IrcKey(strKey)] = valueStream.str();
 }
 
 template<>
 inline void IniFile::Section::SetValue<std::string>(const std::string &strKey, const std::string &strValue) {
-	m_mValueMap[strKey] = strValue;
+	m_mValueMap[IrcKey(strKey)] = strValue;
 }
 
 #endif // !INIFILE_H
@@ -63,6 +63,7 @@
 #define RPL_WHOREPLY		352
 #define RPL_ENDOFWHO		315
 #define RPL_NAMEREPLY		353
+#define RPL_WHOSPCRPL		354
 #define RPL_ENDOFNAMES		366
 #define RPL_LINKS		364
 #define RPL_ENDOFLINKS		365
@@ -158,6 +159,7 @@
 #define ERR_INVITEONLYCHAN	473
 #define ERR_BANNEDFROMCHAN	474
 #define ERR_BADCHANNELKEY	475
+#define ERR_BANLISTFULL		478
 #define ERR_NOPRIVILEGES	481
 #define ERR_CHANOPRIVSNEEDED	482
 #define ERR_CANTKILLSERVER	483
@@ -165,5 +167,16 @@
 #define ERR_UMODEUNKNOWNFLAG	501
 #define ERR_USERSDONTMATCH	502
 
+// IRCv3 SASL
+#define RPL_LOGGEDIN		900
+#define RPL_LOGGEDOUT		901
+#define ERR_NICKLOCKED		902
+#define RPL_SASLSUCCESS		903
+#define ERR_SASLFAIL		904
+#define ERR_SASLTOOLONG		905
+#define ERR_SASLABORTED		906
+#define ERR_SASLALREADY		907
+#define RPL_SASLMECHS		908
+
 #endif // !IRC_H
 
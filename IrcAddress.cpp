@@ -0,0 +1,197 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cctype>
+#include "IrcAddress.h"
+
+bool IrcAddress::Parse(const char *pString) {
+	const char *pEnd = pString + strlen(pString);
+
+	Reset();
+
+	if (strchr(pString, ':') != NULL)
+		return ParseIPv6(pString, pEnd, m_bytes);
+
+	m_bytes[10] = m_bytes[11] = 0xff;
+
+	return ParseIPv4(pString, pEnd, m_bytes + 12);
+}
+
+bool IrcAddress::ParseCidr(const char *pString, unsigned int &prefixLength) {
+	const char *pSlash = strchr(pString, '/');
+
+	Reset();
+
+	if (pSlash == NULL || pSlash[1] == '\0' || strlen(pSlash+1) > 3)
+		return false;
+
+	prefixLength = 0;
+
+	for (const char *p = pSlash+1; *p != '\0'; ++p) {
+		if (!isdigit((unsigned char)*p))
+			return false;
+
+		prefixLength = 10*prefixLength + (*p - '0');
+	}
+
+	if (memchr(pString, ':', pSlash - pString) != NULL) {
+		if (prefixLength > BITS || !ParseIPv6(pString, pSlash, m_bytes))
+			return false;
+	}
+	else {
+		if (prefixLength > 32 || !ParseIPv4(pString, pSlash, m_bytes + 12))
+			return false;
+
+		m_bytes[10] = m_bytes[11] = 0xff;
+		prefixLength += BITS - 32;
+	}
+
+	Truncate(prefixLength);
+
+	return true;
+}
+
+unsigned int IrcAddress::CommonPrefixLength(const IrcAddress &clAddress) const {
+	for (unsigned int i = 0; i < SIZE; ++i) {
+		unsigned int diff = m_bytes[i] ^ clAddress.m_bytes[i];
+
+		if (diff == 0)
+			continue;
+
+		unsigned int length = 8*i;
+
+		for ( ; (diff & 0x80) == 0; diff <<= 1)
+			++length;
+
+		return length;
+	}
+
+	return BITS;
+}
+
+void IrcAddress::Truncate(unsigned int prefixLength) {
+	if (prefixLength >= BITS)
+		return;
+
+	unsigned int i = prefixLength >> 3;
+
+	m_bytes[i] &= (unsigned char)(0xff00 >> (prefixLength & 7));
+
+	while (++i < SIZE)
+		m_bytes[i] = 0;
+}
+
+bool IrcAddress::ParseIPv4(const char *pBegin, const char *pEnd, unsigned char *pBytes) {
+	const char *p = pBegin;
+
+	for (int i = 0; i < 4; ++i) {
+		if (i > 0 && (p == pEnd || *p++ != '.'))
+			return false;
+
+		const char *q = p;
+		unsigned int octet = 0;
+
+		for ( ; q != pEnd && isdigit((unsigned char)*q) && q - p < 3; ++q)
+			octet = 10*octet + (*q - '0');
+
+		// Leading zeros could be read as octal
+		if (q == p || octet > 255 || (*p == '0' && q - p > 1))
+			return false;
+
+		p = q;
+
+		pBytes[i] = (unsigned char)octet;
+	}
+
+	return p == pEnd;
+}
+
+bool IrcAddress::ParseIPv6(const char *pBegin, const char *pEnd, unsigned char *pBytes) {
+	unsigned char groups[SIZE];
+	int numBytes = 0, gap = -1;
+	const char *p = pBegin;
+
+	if (pEnd - p >= 2 && p[0] == ':' && p[1] == ':') {
+		gap = 0;
+		p += 2;
+	}
+
+	while (p != pEnd) {
+		const char *q = p;
+		unsigned int group = 0;
+
+		for ( ; q != pEnd && isxdigit((unsigned char)*q) && q - p < 4; ++q)
+			group = 16*group + (isdigit((unsigned char)*q) ? *q - '0' : tolower((unsigned char)*q) - 'a' + 10);
+
+		// A trailing IPv4 address fills the last two groups
+		if (q != pEnd && *q == '.') {
+			if (numBytes > SIZE-4 || !ParseIPv4(p, pEnd, groups + numBytes))
+				return false;
+
+			numBytes += 4;
+			break;
+		}
+
+		if (q == p || numBytes > SIZE-2)
+			return false;
+
+		groups[numBytes++] = (unsigned char)(group >> 8);
+		groups[numBytes++] = (unsigned char)group;
+
+		if (q == pEnd)
+			break;
+
+		if (*q != ':' || ++q == pEnd)
+			return false;
+
+		if (*q == ':') {
+			if (gap >= 0)
+				return false;
+
+			gap = numBytes;
+			++q;
+		}
+
+		p = q;
+	}
+
+	if (gap < 0) {
+		if (numBytes != SIZE)
+			return false;
+
+		memcpy(pBytes, groups, SIZE);
+		return true;
+	}
+
+	// "::" stands for at least one zero group
+	if (numBytes > SIZE-2)
+		return false;
+
+	memset(pBytes, 0, SIZE);
+	memcpy(pBytes, groups, gap);
+	memcpy(pBytes + SIZE - (numBytes - gap), groups + gap, numBytes - gap);
+
+	return true;
+}
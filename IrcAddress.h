@@ -0,0 +1,72 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCADDRESS_H
+#define IRCADDRESS_H
+
+#include <cstring>
+
+// An IPv4 or IPv6 address parsed from a hostname
+// IPv4 addresses are kept IPv4-mapped (::ffff:a.b.c.d) so both families share one bit string
+class IrcAddress {
+public:
+	enum { SIZE = 16, BITS = 128 };
+
+	IrcAddress() {
+		Reset();
+	}
+
+	// Only accepts IP literals
+	bool Parse(const char *pString);
+
+	// Accepts address/length, IPv4 lengths are converted to IPv4-mapped lengths
+	// Bits after the prefix are cleared
+	bool ParseCidr(const char *pString, unsigned int &prefixLength);
+
+	unsigned int GetBit(unsigned int i) const {
+		return (m_bytes[i >> 3] >> (7 - (i & 7))) & 1;
+	}
+
+	bool HasPrefix(const IrcAddress &clPrefix, unsigned int prefixLength) const {
+		return CommonPrefixLength(clPrefix) >= prefixLength;
+	}
+
+	unsigned int CommonPrefixLength(const IrcAddress &clAddress) const;
+
+	// Clears the bits after prefixLength
+	void Truncate(unsigned int prefixLength);
+
+	void Reset() {
+		memset(m_bytes, 0, sizeof(m_bytes));
+	}
+
+private:
+	unsigned char m_bytes[SIZE];
+
+	static bool ParseIPv4(const char *pBegin, const char *pEnd, unsigned char *pBytes);
+	static bool ParseIPv6(const char *pBegin, const char *pEnd, unsigned char *pBytes);
+};
+
+#endif // !IRCADDRESS_H
@@ -0,0 +1,133 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IrcCidrTree.h"
+
+void IrcCidrTree::Insert(const IrcAddress &clPrefix, unsigned int prefixLength, unsigned int value) {
+	IrcAddress clKey(clPrefix);
+	clKey.Truncate(prefixLength);
+
+	// Invariant: node's prefix is a prefix of the key
+	unsigned int node = 0;
+
+	while (m_vNodes[node].prefixLength < prefixLength) {
+		const unsigned int bit = clKey.GetBit(m_vNodes[node].prefixLength);
+		const unsigned int child = m_vNodes[node].children[bit];
+
+		if (child == NO_NODE) {
+			const unsigned int leaf = NewNode(clKey, prefixLength);
+			m_vNodes[leaf].vValues.push_back(value);
+			m_vNodes[node].children[bit] = leaf;
+			return;
+		}
+
+		unsigned int common = clKey.CommonPrefixLength(m_vNodes[child].clPrefix);
+
+		if (common > prefixLength)
+			common = prefixLength;
+
+		if (common >= m_vNodes[child].prefixLength) {
+			node = child;
+			continue;
+		}
+
+		// Split the edge to child at the first differing bit
+		IrcAddress clSplit(clKey);
+		clSplit.Truncate(common);
+
+		const unsigned int split = NewNode(clSplit, common);
+
+		m_vNodes[split].children[m_vNodes[child].clPrefix.GetBit(common)] = child;
+		m_vNodes[node].children[bit] = split;
+
+		if (common == prefixLength) {
+			m_vNodes[split].vValues.push_back(value);
+			return;
+		}
+
+		const unsigned int leaf = NewNode(clKey, prefixLength);
+		m_vNodes[leaf].vValues.push_back(value);
+		m_vNodes[split].children[clKey.GetBit(common)] = leaf;
+		return;
+	}
+
+	m_vNodes[node].vValues.push_back(value);
+}
+
+void IrcCidrTree::Collect(const IrcAddress &clAddress, std::vector<const Bucket *> &vBuckets) const {
+	unsigned int node = 0;
+
+	for ( ; ; ) {
+		const Node &clNode = m_vNodes[node];
+
+		if (!clNode.vValues.empty())
+			vBuckets.push_back(&clNode.vValues);
+
+		if (clNode.prefixLength >= IrcAddress::BITS)
+			return;
+
+		node = clNode.children[clAddress.GetBit(clNode.prefixLength)];
+
+		if (node == NO_NODE || !clAddress.HasPrefix(m_vNodes[node].clPrefix, m_vNodes[node].prefixLength))
+			return;
+	}
+}
+
+void IrcCidrTree::Renumber(const std::vector<unsigned int> &vValues) {
+	for (size_t i = 0; i < m_vNodes.size(); ++i)
+		Renumber(m_vNodes[i].vValues, vValues);
+}
+
+void IrcCidrTree::Renumber(Bucket &vBucket, const std::vector<unsigned int> &vValues) {
+	size_t j = 0;
+
+	for (size_t i = 0; i < vBucket.size(); ++i) {
+		const unsigned int value = vValues[vBucket[i]];
+
+		if (value != NO_VALUE)
+			vBucket[j++] = value;
+	}
+
+	vBucket.resize(j);
+}
+
+void IrcCidrTree::Reset() {
+	m_vNodes.clear();
+	NewNode(IrcAddress(), 0);
+}
+
+unsigned int IrcCidrTree::NewNode(const IrcAddress &clPrefix, unsigned int prefixLength) {
+	const unsigned int node = (unsigned int)m_vNodes.size();
+
+	m_vNodes.push_back(Node());
+
+	Node &clNode = m_vNodes.back();
+
+	clNode.clPrefix = clPrefix;
+	clNode.prefixLength = prefixLength;
+	clNode.children[0] = clNode.children[1] = NO_NODE;
+
+	return node;
+}
@@ -0,0 +1,74 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCCIDRTREE_H
+#define IRCCIDRTREE_H
+
+#include <vector>
+#include "IrcAddress.h"
+
+// Path compressed binary radix (patricia) tree of address prefixes
+// Each prefix holds a list of values, lookups visit at most one node per address bit
+class IrcCidrTree {
+public:
+	enum { NO_VALUE = 0xffffffff };
+
+	typedef std::vector<unsigned int> Bucket;
+
+	IrcCidrTree() {
+		Reset();
+	}
+
+	// Values are kept in insertion order
+	void Insert(const IrcAddress &clPrefix, unsigned int prefixLength, unsigned int value);
+
+	// Adds the non-empty bucket of every prefix containing clAddress, shortest first
+	void Collect(const IrcAddress &clAddress, std::vector<const Bucket *> &vBuckets) const;
+
+	// Every value v becomes vValues[v], values mapped to NO_VALUE are dropped
+	void Renumber(const std::vector<unsigned int> &vValues);
+
+	// Same for one bucket, the order is kept
+	static void Renumber(Bucket &vBucket, const std::vector<unsigned int> &vValues);
+
+	void Reset();
+
+private:
+	enum { NO_NODE = 0xffffffff };
+
+	struct Node {
+		IrcAddress clPrefix;
+		unsigned int prefixLength;
+		unsigned int children[2];
+		Bucket vValues;
+	};
+
+	// m_vNodes[0] is the root, the empty prefix
+	std::vector<Node> m_vNodes;
+
+	unsigned int NewNode(const IrcAddress &clPrefix, unsigned int prefixLength);
+};
+
+#endif // !IRCCIDRTREE_H
@@ -51,6 +51,7 @@
 #include <iostream>
 #include "IrcClient.h"
 #include "IrcUser.h"
+#include "IrcClock.h"
 #include "IrcString.h"
 #include "Irc.h"
 
@@ -69,6 +70,131 @@ namespace {
 	
 		return pTmp;
 	}
+
+	struct CapabilityName {
+		const char *pName;
+		IrcClient::CapabilityType eCap;
+	};
+
+	const CapabilityName s_capabilityNames[] = {
+		{ "userhost-in-names", IrcClient::CAP_USERHOST_IN_NAMES },
+		{ "multi-prefix", IrcClient::CAP_MULTI_PREFIX },
+		{ "extended-join", IrcClient::CAP_EXTENDED_JOIN },
+		{ "chghost", IrcClient::CAP_CHGHOST },
+		{ "away-notify", IrcClient::CAP_AWAY_NOTIFY },
+		{ "sasl", IrcClient::CAP_SASL },
+		{ "server-time", IrcClient::CAP_SERVER_TIME },
+		{ "message-tags", IrcClient::CAP_MESSAGE_TAGS }
+	};
+
+	const size_t s_numCapabilityNames = sizeof(s_capabilityNames)/sizeof(s_capabilityNames[0]);
+
+	// Capabilities in a space separated list, either the ones prefixed with '-' or the rest
+	unsigned int ParseCapabilities(const char *pCaps, bool bDisabled) {
+		unsigned int caps = 0;
+
+		while (*pCaps != '\0') {
+			for ( ; *pCaps == ' '; ++pCaps);
+
+			const bool bMinus = (*pCaps == '-');
+
+			if (bMinus)
+				++pCaps;
+
+			// CAP LS 302 may attach values (e.g. sasl=PLAIN)
+			const size_t length = strcspn(pCaps, " =");
+
+			if (bMinus == bDisabled) {
+				for (size_t i = 0; i < s_numCapabilityNames; ++i) {
+					const char *pName = s_capabilityNames[i].pName;
+
+					if (strlen(pName) == length && !strncmp(pName, pCaps, length)) {
+						caps |= s_capabilityNames[i].eCap;
+						break;
+					}
+				}
+			}
+
+			pCaps += length;
+
+			for ( ; *pCaps != ' ' && *pCaps != '\0'; ++pCaps);
+		}
+
+		return caps;
+	}
+
+	// The value CAP LS 302 attached to a capability (e.g. PLAIN,EXTERNAL for sasl)
+	std::string FindCapabilityValue(const char *pCaps, const char *pName) {
+		const size_t nameLength = strlen(pName);
+
+		while (*pCaps != '\0') {
+			for ( ; *pCaps == ' '; ++pCaps);
+
+			const size_t length = strcspn(pCaps, " ");
+
+			if (length > nameLength && pCaps[nameLength] == '=' && !strncmp(pCaps, pName, nameLength))
+				return std::string(pCaps + nameLength + 1, length - nameLength - 1);
+
+			pCaps += length;
+		}
+
+		return std::string();
+	}
+
+	// Whether a comma separated list has the item
+	bool HasListItem(const std::string &strList, const char *pItem) {
+		std::stringstream listStream(strList);
+
+		std::string strItem;
+		while (std::getline(listStream, strItem, ',')) {
+			if (!IrcStrCaseCmp(strItem.c_str(), pItem))
+				return true;
+		}
+
+		return false;
+	}
+
+	std::string Base64Encode(const std::string &strData) {
+		static const char aAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+		std::string strEncoded;
+		strEncoded.reserve((strData.size() + 2)/3*4);
+
+		for (size_t i = 0; i < strData.size(); i += 3) {
+			const size_t remaining = strData.size() - i;
+
+			unsigned int bits = (unsigned char)strData[i] << 16;
+
+			if (remaining > 1)
+				bits |= (unsigned char)strData[i+1] << 8;
+
+			if (remaining > 2)
+				bits |= (unsigned char)strData[i+2];
+
+			strEncoded += aAlphabet[(bits >> 18) & 0x3f];
+			strEncoded += aAlphabet[(bits >> 12) & 0x3f];
+			strEncoded += remaining > 1 ? aAlphabet[(bits >> 6) & 0x3f] : '=';
+			strEncoded += remaining > 2 ? aAlphabet[bits & 0x3f] : '=';
+		}
+
+		return strEncoded;
+	}
+
+	std::string FormatCapabilities(unsigned int caps) {
+		std::string strCaps;
+
+		for (size_t i = 0; i < s_numCapabilityNames; ++i) {
+			if ((caps & s_capabilityNames[i].eCap) == 0)
+				continue;
+
+			if (!strCaps.empty())
+				strCaps += ' ';
+
+			strCaps += s_capabilityNames[i].pName;
+		}
+
+		return strCaps;
+	}
 } // end namespace
 
 IrcClient::IrcClient() {
@@ -77,10 +203,19 @@ IrcClient::IrcClient() {
 	m_strRealName = "IrcClient";
 	m_stagingBufferSize = 0;
 	m_lastRecvTime = 0;
+	m_wantedCaps = CAP_ALL;
+	m_offeredCaps = m_enabledCaps = 0;
+	m_bCapNegotiating = false;
+	m_eSaslMechanism = SASL_NONE;
+	m_bAuthenticating = m_bLoggedIn = false;
+	m_bTls = false;
+	m_bTlsVerify = true;
 	m_pEventBase = NULL; 
+	m_pTimerWheel = NULL;
 	m_clReadEvent = IrcEvent::Bind<IrcClient, &IrcClient::OnRead>(this);
 	m_clWriteEvent = IrcEvent::Bind<IrcClient, &IrcClient::OnWrite>(this);
-	m_clSendTimer = IrcEvent::Bind<IrcClient, &IrcClient::OnSendTimer>(this);
+	m_clSendTimer = IrcTimer::Bind<IrcClient, &IrcClient::OnSendTimer>(this);
+	m_clSaslTimer = IrcTimer::Bind<IrcClient, &IrcClient::OnSaslTimer>(this);
 }
 
 
@@ -90,12 +225,21 @@ IrcClient::~IrcClient() {
 
 void IrcClient::SetEventBase(struct event_base *pEventBase) {
 	m_pEventBase = pEventBase;
+	m_clOwnTimerWheel.SetEventBase(pEventBase);
 }
 
 struct event_base * IrcClient::GetEventBase() const {
 	return m_pEventBase;
 }
 
+void IrcClient::SetTimerWheel(IrcTimerWheel *pTimerWheel) {
+	m_pTimerWheel = pTimerWheel;
+}
+
+IrcTimerWheel * IrcClient::GetTimerWheel() {
+	return m_pTimerWheel != NULL ? m_pTimerWheel : &m_clOwnTimerWheel;
+}
+
 const std::string & IrcClient::GetNickname() const {
 	return m_strNickname;
 }
@@ -121,15 +265,58 @@ bool IrcClient::IsRegistered() const {
 }
 
 bool IrcClient::IsMe(const std::string &strNickname) const {
+	return IsMe(strNickname.c_str());
+}
+
+bool IrcClient::IsMe(const char *pNickname) const {
 	IrcCaseMapping eCaseMapping = GetIrcTraits().GetCaseMapping();
-	return !IrcStrCaseCmp(strNickname.c_str(), 
-				GetCurrentNickname().c_str(), eCaseMapping);
+	return !IrcStrCaseCmp(pNickname, GetCurrentNickname().c_str(), eCaseMapping);
 }
 
 time_t IrcClient::GetLastRecvTime() const {
 	return m_lastRecvTime;
 }
 
+void IrcClient::SetWantedCapabilities(unsigned int wantedCaps) {
+	m_wantedCaps = wantedCaps & CAP_ALL;
+}
+
+unsigned int IrcClient::GetWantedCapabilities() const {
+	return m_wantedCaps;
+}
+
+bool IrcClient::HasCapability(CapabilityType eCap) const {
+	return (m_enabledCaps & eCap) != 0;
+}
+
+void IrcClient::SetSasl(SaslMechanismType eMechanism, const std::string &strAccount, const std::string &strPassword) {
+	m_eSaslMechanism = eMechanism;
+	m_strSaslAccount = strAccount;
+	m_strSaslPassword = strPassword;
+}
+
+bool IrcClient::IsLoggedIn() const {
+	return m_bLoggedIn;
+}
+
+void IrcClient::SetTls(bool bTls, bool bVerify) {
+	m_bTls = bTls;
+	m_bTlsVerify = bVerify;
+}
+
+bool IrcClient::IsTls() const {
+	return m_bTls;
+}
+
+void IrcClient::SetTlsCertificate(const std::string &strCertFile, const std::string &strKeyFile) {
+	m_strTlsCertFile = strCertFile;
+	m_strTlsKeyFile = strKeyFile;
+}
+
+bool IrcClient::HasTlsCertificate() const {
+	return m_bTls && !m_strTlsCertFile.empty();
+}
+
 void IrcClient::SetNickname(const std::string &strNickname) {
 	m_strNickname = strNickname;
 }
@@ -218,7 +405,8 @@ bool IrcClient::Connect(const std::string &strServer, const std::string &strPort
 	// XXX: Handle errors?
 	m_clWriteEvent.New(m_pEventBase, m_socket, EV_WRITE);
 	m_clReadEvent.New(m_pEventBase, m_socket, EV_READ | EV_PERSIST);
-	m_clSendTimer.NewTimer(m_pEventBase, EV_PERSIST);
+	m_clSendTimer.NewTimer(GetTimerWheel(), EV_PERSIST);
+	m_clSaslTimer.NewTimer(GetTimerWheel(), 0);
 
 	m_clWriteEvent.Add();
 
@@ -253,16 +441,22 @@ void IrcClient::Disconnect() {
 	m_stagingBufferSize = 0;
 	m_lastRecvTime = 0;
 
+	m_offeredCaps = m_enabledCaps = 0;
+	m_bCapNegotiating = false;
+
+	m_strSaslMechanisms.clear();
+	m_bAuthenticating = m_bLoggedIn = false;
+
 	CloseSocket();
 
 	m_clWriteEvent.Free();
 	m_clReadEvent.Free();
 	m_clSendTimer.Free();
+	m_clSaslTimer.Free();
 }
 
 void IrcClient::Log(const char *pFormat, ...) {
-	time_t rawTime = 0;
-	time(&rawTime);
+	time_t rawTime = IrcClock::WallNow();
 
 	// XXX: Not thread-safe
 	struct tm *pLocalTime = localtime(&rawTime);
@@ -314,6 +508,21 @@ void IrcClient::Send(WhenType eWhen, const char *pFormat, ...) {
 
 }
 
+const IrcMessageTags & IrcClient::GetMessageTags() const {
+	return m_clMessageTags;
+}
+
+time_t IrcClient::GetMessageTime() const {
+	const time_t now = IrcClock::WallNow();
+	time_t serverTime = 0;
+
+	// Skewed server clocks shouldn't put things in the future
+	if (!m_clMessageTags.GetServerTime(serverTime) || serverTime > now)
+		return now;
+
+	return serverTime;
+}
+
 void IrcClient::SendRaw(const void *pData, size_t dataSize) {
 	if (m_socket == INVALID_SOCKET)
 		return;
@@ -322,6 +531,12 @@ void IrcClient::SendRaw(const void *pData, size_t dataSize) {
 
 	m_clSendCounter.Hit();
 
+	if (m_bTls) {
+		m_strTlsSendBuffer.append((const char *)pData, dataSize);
+		FlushTlsSendBuffer();
+		return;
+	}
+
 #ifdef _WIN32
 	send(m_socket, (const char *)pData, (int)dataSize, 0);
 #else // !_WIN32
@@ -332,6 +547,12 @@ void IrcClient::SendRaw(const void *pData, size_t dataSize) {
 void IrcClient::OnConnect() {
 	Log("Connected.");
 
+	// Servers that support CAP hold registration until CAP END, the rest ignore it
+	if (m_wantedCaps != 0) {
+		m_bCapNegotiating = true;
+		Send(NOW, "CAP LS 302\r\n");
+	}
+
 	Send(NOW, "NICK %s\r\n", m_strNickname.c_str());
 	Send(NOW, "USER %s localhost localhost :%s\r\n", m_strUsername.c_str(), m_strRealName.c_str());
 
@@ -360,10 +581,34 @@ void IrcClient::OnNumeric(const char *pPrefix, int numeric, const char **pParams
 		if (!IsRegistered()) {
 			m_strCurrentServer = pPrefix;
 			m_strCurrentNickname = pParams[0];
+			m_bCapNegotiating = false;
 			// RFC1459 guarantees RPL_LUSERCLIENT after successful registration
 			OnRegistered();
 		}
 		break;
+	case RPL_LOGGEDIN:
+		m_bLoggedIn = true;
+
+		if (numParams > 2)
+			Log("Logged in as %s", pParams[2]);
+
+		break;
+	case RPL_LOGGEDOUT:
+		m_bLoggedIn = false;
+		break;
+	case RPL_SASLSUCCESS:
+		EndAuthentication();
+		break;
+	case ERR_NICKLOCKED:
+	case ERR_SASLFAIL:
+	case ERR_SASLTOOLONG:
+	case ERR_SASLABORTED:
+	case ERR_SASLALREADY:
+		if (m_bAuthenticating) {
+			Log("SASL %s authentication failed (%d).", GetSaslMechanismName(), numeric);
+			EndAuthentication();
+		}
+		break;
 	case ERR_NICKNAMEINUSE:
 		if (!IsRegistered())
 		{
@@ -391,9 +636,7 @@ void IrcClient::OnNumeric(const char *pPrefix, int numeric, const char **pParams
 void IrcClient::OnNick(const char *pSource, const char *pNewNick) {
 	IrcUser clUser(pSource);
 
-	const std::string &strNickname = clUser.GetNickname();
-
-	if (IsMe(strNickname)) {
+	if (IsMe(clUser.GetNickname().c_str())) {
 		m_strCurrentNickname = pNewNick;
 		Log("Nickname changed to %s", pNewNick);
 	}
@@ -427,7 +670,7 @@ void IrcClient::OnKick(const char *pSource, const char *pChannel, const char *pU
 
 }
 
-void IrcClient::OnPrivmsg(const char *pSource, const char *pTarget, const char *pMessage) {
+void IrcClient::OnPrivmsg(const char *pSource, const char *pTarget, char *pMessage) {
 
 }
 
@@ -450,10 +693,153 @@ void IrcClient::OnWallops(const char *pSource, const char *pMessage) {
 
 }
 
+void IrcClient::OnCap(const char *pSource, const char *pSubcommand, const char *pParams[], unsigned int numParams) {
+	if (numParams == 0)
+		return;
+
+	// All but the last line of a multiline reply carry a '*'
+	const bool bMore = numParams > 1 && !strcmp(pParams[0], "*");
+	const char *pCaps = pParams[numParams-1];
+
+	if (!strcmp(pSubcommand, "LS") || !strcmp(pSubcommand, "NEW")) {
+		m_offeredCaps |= ParseCapabilities(pCaps, false);
+
+		const std::string strMechanisms = FindCapabilityValue(pCaps, "sasl");
+
+		if (!strMechanisms.empty())
+			m_strSaslMechanisms = strMechanisms;
+
+		if (bMore)
+			return;
+
+		unsigned int requestCaps = m_offeredCaps & m_wantedCaps & ~m_enabledCaps;
+
+		// Only during registration and with a mechanism the server takes
+		bool bSasl = m_bCapNegotiating && m_eSaslMechanism != SASL_NONE &&
+			(m_strSaslMechanisms.empty() || HasListItem(m_strSaslMechanisms, GetSaslMechanismName()));
+
+		// EXTERNAL logs in with the client certificate
+		if (bSasl && (requestCaps & CAP_SASL) && m_eSaslMechanism == SASL_EXTERNAL && !HasTlsCertificate()) {
+			Log("SASL EXTERNAL needs TLS with a client certificate, not authenticating.");
+			bSasl = false;
+		}
+
+		if (!bSasl)
+			requestCaps &= ~CAP_SASL;
+
+		if (requestCaps != 0)
+			Send(NOW, "CAP REQ :%s\r\n", FormatCapabilities(requestCaps).c_str());
+		else
+			EndCapNegotiation();
+	}
+	else if (!strcmp(pSubcommand, "ACK")) {
+		m_enabledCaps |= ParseCapabilities(pCaps, false);
+		m_enabledCaps &= ~ParseCapabilities(pCaps, true);
+
+		if (bMore || m_bAuthenticating)
+			return;
+
+		// CAP END waits for the outcome
+		if (m_bCapNegotiating && HasCapability(CAP_SASL) && m_eSaslMechanism != SASL_NONE && !m_bLoggedIn) {
+			m_bAuthenticating = true;
+			Send(NOW, "AUTHENTICATE %s\r\n", GetSaslMechanismName());
+
+			struct timeval tv;
+			tv.tv_sec = SASL_TIMEOUT;
+			tv.tv_usec = 0;
+
+			m_clSaslTimer.Add(&tv);
+			return;
+		}
+
+		EndCapNegotiation();
+	}
+	else if (!strcmp(pSubcommand, "NAK")) {
+		Log("Server refused capabilities: %s", pCaps);
+		EndCapNegotiation();
+	}
+	else if (!strcmp(pSubcommand, "DEL")) {
+		const unsigned int delCaps = ParseCapabilities(pCaps, false);
+
+		m_offeredCaps &= ~delCaps;
+		m_enabledCaps &= ~delCaps;
+	}
+}
+
+void IrcClient::OnChghost(const char *pSource, const char *pNewUsername, const char *pNewHostname) {
+
+}
+
+void IrcClient::OnAway(const char *pSource, const char *pMessage) {
+
+}
+
+void IrcClient::OnAuthenticate(const char *pData) {
+	// Neither PLAIN nor EXTERNAL expect a challenge
+	if (!m_bAuthenticating || strcmp(pData, "+") != 0)
+		return;
+
+	if (m_eSaslMechanism == SASL_EXTERNAL) {
+		Send(NOW, "AUTHENTICATE +\r\n");
+		return;
+	}
+
+	std::string strMessage = m_strSaslAccount;
+	strMessage += '\0';
+	strMessage += m_strSaslAccount;
+	strMessage += '\0';
+	strMessage += m_strSaslPassword;
+
+	const std::string strEncoded = Base64Encode(strMessage);
+
+	// Sent 400 bytes at a time, a full last chunk is followed by an empty one
+	size_t i = 0;
+
+	for ( ; strEncoded.size() - i >= 400; i += 400)
+		Send(NOW, "AUTHENTICATE %s\r\n", strEncoded.substr(i, 400).c_str());
+
+	if (i < strEncoded.size())
+		Send(NOW, "AUTHENTICATE %s\r\n", strEncoded.c_str() + i);
+	else
+		Send(NOW, "AUTHENTICATE +\r\n");
+}
+
+void IrcClient::EndCapNegotiation() {
+	if (!m_bCapNegotiating)
+		return;
+
+	m_bCapNegotiating = false;
+
+	Send(NOW, "CAP END\r\n");
+}
+
+void IrcClient::EndAuthentication() {
+	m_bAuthenticating = false;
+	m_clSaslTimer.Delete();
+
+	EndCapNegotiation();
+}
+
+const char * IrcClient::GetSaslMechanismName() const {
+	switch (m_eSaslMechanism) {
+	case SASL_PLAIN:
+		return "PLAIN";
+	case SASL_EXTERNAL:
+		return "EXTERNAL";
+	default:
+		break;
+	}
+
+	return "";
+}
+
 void IrcClient::CloseSocket() {
 	if (m_socket == INVALID_SOCKET)
 		return;
 
+	m_clTlsSocket.Close();
+	m_strTlsSendBuffer.clear();
+
 #ifdef _WIN32
 	closesocket(m_socket);
 #else // !_WIN32
@@ -469,6 +855,12 @@ void IrcClient::ProcessLine(char *pLine) {
 
 	//puts(pLine);
 
+	// Tags are views into pLine
+	if (*pLine == '@')
+		m_clMessageTags.Parse(PopToken(pLine)+1);
+	else
+		m_clMessageTags.Reset();
+
 	if (*pLine == ':')
 		pPrefix = PopToken(pLine)+1;
 
@@ -516,7 +908,8 @@ void IrcClient::ProcessLine(char *pLine) {
 		OnKick(pPrefix, pParams[0], pParams[1], pParams[2]);
 	}
 	else if (!strcmp(pCommand, "PRIVMSG")) {
-		OnPrivmsg(pPrefix, pParams[0], pParams[1]);
+		// Parameters point into pLine
+		OnPrivmsg(pPrefix, pParams[0], const_cast<char *>(pParams[1]));
 	}
 	else if (!strcmp(pCommand, "NOTICE")) {
 		OnNotice(pPrefix, pParams[0], pParams[1]);
@@ -533,10 +926,27 @@ void IrcClient::ProcessLine(char *pLine) {
 	else if (!strcmp(pCommand, "WALLOPS")) {
 		OnWallops(pPrefix, pParams[0]);
 	}
+	else if (!strcmp(pCommand, "CAP")) {
+		if (numParams >= 2)
+			OnCap(pPrefix, pParams[1], pParams+2, numParams-2);
+	}
+	else if (!strcmp(pCommand, "CHGHOST")) {
+		if (numParams >= 2)
+			OnChghost(pPrefix, pParams[0], pParams[1]);
+	}
+	else if (!strcmp(pCommand, "AUTHENTICATE")) {
+		if (numParams >= 1)
+			OnAuthenticate(pParams[0]);
+	}
+	else if (!strcmp(pCommand, "AWAY")) {
+		OnAway(pPrefix, pParams[0]);
+	}
 
+	// pLine is about to be reused
+	m_clMessageTags.Reset();
 }
 
-void IrcClient::OnWrite(evutil_socket_t fd, short what) {
+void IrcClient::StartSession() {
 	m_clReadEvent.Add();
 
 	// TODO: Tunable for send timer
@@ -551,7 +961,130 @@ void IrcClient::OnWrite(evutil_socket_t fd, short what) {
 	OnConnect();
 }
 
+void IrcClient::ContinueTlsHandshake() {
+	switch (m_clTlsSocket.Handshake()) {
+	case IrcTlsSocket::RESULT_OK:
+		Log("TLS established (%s, %s).", m_clTlsSocket.GetDescription().c_str(), 
+			m_clTlsSocket.IsResumed() ? "resumed session" : "full handshake");
+		StartSession();
+		break;
+	case IrcTlsSocket::RESULT_WANT_READ:
+		m_clReadEvent.Add();
+		break;
+	case IrcTlsSocket::RESULT_WANT_WRITE:
+		m_clWriteEvent.Add();
+		break;
+	default:
+		Log("TLS handshake failed: %s", m_clTlsSocket.GetError().c_str());
+		OnDisconnect();
+		break;
+	}
+}
+
+void IrcClient::FlushTlsSendBuffer() {
+	while (!m_strTlsSendBuffer.empty()) {
+		size_t size = m_strTlsSendBuffer.size();
+
+		switch (m_clTlsSocket.Write(m_strTlsSendBuffer.data(), size)) {
+		case IrcTlsSocket::RESULT_OK:
+			m_strTlsSendBuffer.erase(0, size);
+			break;
+		case IrcTlsSocket::RESULT_WANT_READ:
+		case IrcTlsSocket::RESULT_WANT_WRITE:
+			// Retried with the same leading bytes from OnWrite()
+			m_clWriteEvent.Add();
+			return;
+		default:
+			// Like send(), the failure is noticed when reading
+			Log("TLS write failed: %s", m_clTlsSocket.GetError().c_str());
+			m_strTlsSendBuffer.clear();
+			return;
+		}
+	}
+}
+
+void IrcClient::ReadTls() {
+	do {
+		size_t readSize = sizeof(m_stagingBuffer)-1-m_stagingBufferSize;
+
+		switch (m_clTlsSocket.Read(m_stagingBuffer + m_stagingBufferSize, readSize)) {
+		case IrcTlsSocket::RESULT_OK:
+			break;
+		case IrcTlsSocket::RESULT_WANT_READ:
+		case IrcTlsSocket::RESULT_WANT_WRITE:
+			return;
+		case IrcTlsSocket::RESULT_CLOSED:
+			Log("Remote host closed the connection.");
+			OnDisconnect();
+			return;
+		default:
+			Log("TLS read failed: %s", m_clTlsSocket.GetError().c_str());
+			OnDisconnect();
+			return;
+		}
+
+		ProcessStagingBuffer(readSize);
+
+		// Decrypted data left over from the last record won't wake the read event
+	} while (m_clTlsSocket.IsHandshakeDone() && m_clTlsSocket.HasPending());
+}
+
+void IrcClient::ProcessStagingBuffer(size_t readSize) {
+	m_lastRecvTime = IrcClock::Now();
+
+	m_stagingBufferSize += readSize;
+
+	m_stagingBuffer[m_stagingBufferSize] = '\0';
+
+	char *p, *q;
+
+	p = q = m_stagingBuffer;
+
+	// We check the buffer size since Disconnect() can be called somewhere in ProcessLine()
+	while (m_stagingBufferSize > 0 && (q = strpbrk(p,"\r\n")) != NULL) {
+		*q = '\0';
+
+		m_stagingBufferSize -= (q-p) + 1;
+		if (q != p)
+			ProcessLine(p);
+
+		p = q + 1;
+	}
+
+	memmove(m_stagingBuffer, p, m_stagingBufferSize);
+}
+
+void IrcClient::OnWrite(evutil_socket_t fd, short what) {
+	if (!m_bTls) {
+		StartSession();
+		return;
+	}
+
+	if (m_clTlsSocket.IsHandshakeDone()) {
+		FlushTlsSendBuffer();
+		return;
+	}
+
+	if (!m_clTlsSocket.IsOpen() && 
+		!m_clTlsSocket.Open(fd, m_strCurrentServer, m_strCurrentPort, m_bTlsVerify, m_strTlsCertFile, m_strTlsKeyFile)) {
+		Log("TLS failed: %s", m_clTlsSocket.GetError().c_str());
+		OnDisconnect();
+		return;
+	}
+
+	ContinueTlsHandshake();
+}
+
 void IrcClient::OnRead(evutil_socket_t fd, short what) {
+	if (m_bTls) {
+		if (m_clTlsSocket.IsHandshakeDone())
+			ReadTls();
+		else
+			ContinueTlsHandshake();
+
+		return;
+	}
+
 #ifdef _WIN32
 	int readSize = recv(m_socket, m_stagingBuffer + m_stagingBufferSize, 
 		(int)(sizeof(m_stagingBuffer)-1-m_stagingBufferSize),0);
@@ -575,28 +1108,19 @@ void IrcClient::OnRead(evutil_socket_t fd, short what) {
 		return;
 	}
 
-	time(&m_lastRecvTime);
-
-	m_stagingBufferSize += readSize;
-
-	m_stagingBuffer[m_stagingBufferSize] = '\0';
-
-	char *p, *q;
-
-	p = q = m_stagingBuffer;
+	ProcessStagingBuffer((size_t)readSize);
+}
 
-	// We check the buffer size since Disconnect() can be called somewhere in ProcessLine()
-	while (m_stagingBufferSize > 0 && (q = strpbrk(p,"\r\n")) != NULL) {
-		*q = '\0';
+void IrcClient::OnSaslTimer(evutil_socket_t fd, short what) {
+	if (!m_bAuthenticating)
+		return;
 
-		m_stagingBufferSize -= (q-p) + 1;
-		if (q != p)
-			ProcessLine(p);
+	Log("SASL %s authentication timed out.", GetSaslMechanismName());
 
-		p = q + 1;
-	}
+	// Abort so the server doesn't take a late reply as part of the exchange
+	Send(NOW, "AUTHENTICATE *\r\n");
 
-	memmove(m_stagingBuffer, p, m_stagingBufferSize);
+	EndAuthentication();
 }
 
 void IrcClient::OnSendTimer(evutil_socket_t fd, short what) {
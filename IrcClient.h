@@ -29,8 +29,11 @@
 #include <string>
 #include <deque>
 #include "IrcTraits.h"
+#include "IrcMessageTags.h"
 #include "IrcCounter.h"
 #include "IrcEvent.h"
+#include "IrcTimerWheel.h"
+#include "IrcTlsSocket.h"
 #include "event2/event.h"
 
 #ifdef _WIN32
@@ -41,6 +44,16 @@
 
 class IrcClient {
 public:
+	// IRCv3 capabilities the client can negotiate
+	enum CapabilityType { CAP_USERHOST_IN_NAMES = 1, CAP_MULTI_PREFIX = 2, CAP_EXTENDED_JOIN = 4, 
+		CAP_CHGHOST = 8, CAP_AWAY_NOTIFY = 16, CAP_SASL = 32, CAP_SERVER_TIME = 64, CAP_MESSAGE_TAGS = 128, 
+		CAP_ALL = 255 };
+
+	enum SaslMechanismType { SASL_NONE = 0, SASL_PLAIN, SASL_EXTERNAL };
+
+	// Seconds to wait for the outcome of SASL authentication before registering without it
+	enum { SASL_TIMEOUT = 30 };
+
 	IrcClient();
 
 	virtual ~IrcClient();
@@ -48,6 +61,10 @@ public:
 	void SetEventBase(struct event_base *pEventBase);
 	struct event_base * GetEventBase() const;
 
+	// Shares a timer wheel on the same event base, otherwise the client keeps its own
+	void SetTimerWheel(IrcTimerWheel *pTimerWheel);
+	IrcTimerWheel * GetTimerWheel();
+
 	const std::string & GetNickname() const;
 
 	const std::string & GetCurrentNickname() const;
@@ -56,8 +73,29 @@ public:
 	const IrcTraits & GetIrcTraits() const;
 	bool IsRegistered() const;
 	bool IsMe(const std::string &strNickname) const;
+	bool IsMe(const char *pNickname) const;
 	time_t GetLastRecvTime() const;
 
+	// Bitwise OR of CapabilityType, requested when the server offers them
+	void SetWantedCapabilities(unsigned int wantedCaps);
+	unsigned int GetWantedCapabilities() const;
+	bool HasCapability(CapabilityType eCap) const;
+
+	// Authenticates during registration when the server offers SASL (the account is ignored for EXTERNAL)
+	void SetSasl(SaslMechanismType eMechanism, const std::string &strAccount = std::string(), 
+		const std::string &strPassword = std::string());
+
+	// SASL authentication succeeded on this connection
+	bool IsLoggedIn() const;
+
+	// Connect with TLS, verifying the server certificate against the system trust store when bVerify is set
+	void SetTls(bool bTls, bool bVerify = true);
+	bool IsTls() const;
+
+	// PEM client certificate presented over TLS (needed for SASL EXTERNAL), the key is in strCertFile when strKeyFile is empty
+	void SetTlsCertificate(const std::string &strCertFile, const std::string &strKeyFile = std::string());
+	bool HasTlsCertificate() const;
+
 	virtual void SetNickname(const std::string &strNickname);
 	virtual void SetUsername(const std::string &strUsername);
 	virtual void SetRealName(const std::string &strRealName);
@@ -73,6 +111,12 @@ protected:
 	virtual void Send(WhenType eWhen, const char *pFormat, ...);
 	virtual void SendRaw(const void *pData, size_t dataSize);
 
+	// Tags of the line being processed (empty outside of events)
+	const IrcMessageTags & GetMessageTags() const;
+
+	// When the line being processed was sent: its server-time if any, otherwise now (wall clock)
+	time_t GetMessageTime() const;
+
 	virtual void OnConnect();
 	virtual void OnDisconnect();
 	virtual void OnRegistered();
@@ -85,12 +129,18 @@ protected:
 	virtual void OnTopic(const char *pSource, const char *pChannel, const char *pTopic);
 	virtual void OnInvite(const char *pSource, const char *pChannel);
 	virtual void OnKick(const char *pSource, const char *pChannel, const char *pUser, const char *pReason);
-	virtual void OnPrivmsg(const char *pSource, const char *pTarget, const char *pMessage);
+	// NOTE: pMessage points into the receive buffer and may be modified in place
+	virtual void OnPrivmsg(const char *pSource, const char *pTarget, char *pMessage);
 	virtual void OnNotice(const char *pSource, const char *pTarget, const char *pMessage);
 	virtual void OnPing(const char *pServer);
 	virtual void OnPong(const char *pServer1, const char *pServer2);
 	virtual void OnError(const char *pMessage);
 	virtual void OnWallops(const char *pSource, const char *pMessage);
+	virtual void OnCap(const char *pSource, const char *pSubcommand, const char *pParams[], unsigned int numParams);
+	virtual void OnChghost(const char *pSource, const char *pNewUsername, const char *pNewHostname);
+	// NOTE: pMessage is NULL when the user is no longer away
+	virtual void OnAway(const char *pSource, const char *pMessage);
+	virtual void OnAuthenticate(const char *pData);
 
 private:
 #ifdef _WIN32
@@ -105,24 +155,64 @@ private:
 		m_strCurrentServer, m_strCurrentPort;
 
 	IrcTraits m_clIrcTraits;
+	IrcMessageTags m_clMessageTags;
 	IrcCounter m_clSendCounter;
 	std::deque<std::string> m_dqSendQueue;
 
-	char m_stagingBuffer[4096];
+	// Room for 8191 bytes of tags and a 512 byte message
+	char m_stagingBuffer[8704];
 	size_t m_stagingBufferSize;
 	time_t m_lastRecvTime;
 
+	unsigned int m_wantedCaps, m_offeredCaps, m_enabledCaps;
+	bool m_bCapNegotiating;
+
+	SaslMechanismType m_eSaslMechanism;
+	std::string m_strSaslAccount, m_strSaslPassword;
+
+	// Mechanisms from CAP LS 302 (empty if the server didn't say)
+	std::string m_strSaslMechanisms;
+	bool m_bAuthenticating, m_bLoggedIn;
+
+	bool m_bTls, m_bTlsVerify;
+	std::string m_strTlsCertFile, m_strTlsKeyFile;
+	IrcTlsSocket m_clTlsSocket;
+
+	// Data SSL_write() could not take yet
+	std::string m_strTlsSendBuffer;
+
 	struct event_base *m_pEventBase;
-	IrcEvent m_clReadEvent, m_clWriteEvent, m_clSendTimer;
+	IrcTimerWheel *m_pTimerWheel;
+	IrcTimerWheel m_clOwnTimerWheel;
+	IrcEvent m_clReadEvent, m_clWriteEvent;
+	IrcTimer m_clSendTimer, m_clSaslTimer;
 
 	void CloseSocket();
 
+	// Starts registration once the connection (and TLS handshake) is up
+	void StartSession();
+
+	void ContinueTlsHandshake();
+	void FlushTlsSendBuffer();
+	void ReadTls();
+
+	// Processes the lines in the staging buffer after readSize more bytes arrived
+	void ProcessStagingBuffer(size_t readSize);
+
+	void EndCapNegotiation();
+
+	// Stops waiting for the outcome of SASL authentication
+	void EndAuthentication();
+
+	const char * GetSaslMechanismName() const;
+
 	void ProcessLine(char *pLine);
 
 	// Libevent callbacks
 	void OnWrite(evutil_socket_t fd, short what);
 	void OnRead(evutil_socket_t fd, short what);
 	void OnSendTimer(evutil_socket_t fd, short what);
+	void OnSaslTimer(evutil_socket_t fd, short what);
 
 };
 
@@ -0,0 +1,76 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+#endif // _WIN32
+
+#include "IrcClock.h"
+
+IrcClock::SourceType IrcClock::ms_pSource = &IrcClock::SystemSource;
+bool IrcClock::ms_bStarted = false;
+time_t IrcClock::ms_startOffset = 0;
+struct timeval IrcClock::ms_stNow;
+time_t IrcClock::ms_wallNow = 0;
+
+void IrcClock::Update() {
+	struct timeval stMonotonic, stWall;
+
+	(*ms_pSource)(stMonotonic, stWall);
+
+	if (!ms_bStarted) {
+		ms_startOffset = stWall.tv_sec - stMonotonic.tv_sec;
+		ms_bStarted = true;
+	}
+
+	ms_stNow = stMonotonic;
+	ms_stNow.tv_sec += ms_startOffset;
+	ms_wallNow = stWall.tv_sec;
+}
+
+void IrcClock::SetSource(SourceType pSource) {
+	ms_pSource = pSource != NULL ? pSource : &IrcClock::SystemSource;
+	ms_bStarted = false;
+
+	Update();
+}
+
+void IrcClock::SystemSource(struct timeval &stMonotonic, struct timeval &stWall) {
+#ifdef _WIN32
+	const ULONGLONG ullMilliseconds = GetTickCount64();
+
+	stMonotonic.tv_sec = (long)(ullMilliseconds / 1000);
+	stMonotonic.tv_usec = (long)(ullMilliseconds % 1000) * 1000;
+#else // !_WIN32
+	struct timespec stTs;
+
+	clock_gettime(CLOCK_MONOTONIC, &stTs);
+
+	stMonotonic.tv_sec = stTs.tv_sec;
+	stMonotonic.tv_usec = stTs.tv_nsec / 1000;
+#endif // _WIN32
+
+	evutil_gettimeofday(&stWall, NULL);
+}
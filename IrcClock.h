@@ -0,0 +1,82 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCCLOCK_H
+#define IRCCLOCK_H
+
+#include <ctime>
+#include "event2/util.h"
+
+// Process wide clock read once per event loop callback instead of on every use
+// Now() is monotonic and never jumps, it starts out at the wall clock time so that it reads like time(NULL).
+// Use WallNow() or ToWallTime() for anything displayed or saved.
+
+class IrcClock {
+public:
+	// Fills in the monotonic and wall clock times
+	typedef void (*SourceType)(struct timeval &stMonotonic, struct timeval &stWall);
+
+	// Reads the source, IrcEvent does this before each callback
+	static void Update();
+
+	static time_t Now() {
+		return GetTime().tv_sec;
+	}
+
+	// Now() with microseconds
+	static const struct timeval & GetTime() {
+		if (!ms_bStarted)
+			Update();
+
+		return ms_stNow;
+	}
+
+	static time_t WallNow() {
+		if (!ms_bStarted)
+			Update();
+
+		return ms_wallNow;
+	}
+
+	// Converts a time from Now() to wall clock time
+	static time_t ToWallTime(time_t monotonicTime) {
+		return monotonicTime + (WallNow() - Now());
+	}
+
+	// Substitutes a virtual clock (e.g. for testing), NULL restores the system clock
+	// NOTE: Now() restarts at the source's wall clock time
+	static void SetSource(SourceType pSource);
+
+private:
+	static SourceType ms_pSource;
+	static bool ms_bStarted;
+	static time_t ms_startOffset;
+	static struct timeval ms_stNow;
+	static time_t ms_wallNow;
+
+	static void SystemSource(struct timeval &stMonotonic, struct timeval &stWall);
+};
+
+#endif // !IRCCLOCK_H
@@ -27,6 +27,7 @@
 #define IRCEVENT_H
 
 #include "event2/event.h"
+#include "IrcClock.h"
 
 class IrcEvent {
 public:
@@ -109,6 +110,7 @@ private:
 	template<class ObjectType, void (ObjectType::*Method)(evutil_socket_t fd, short sWhat)>
 	static void Dispatch(evutil_socket_t fd, short sWhat, void *pArg) {
 		ObjectType * const p_clObject = (ObjectType *)pArg;
+		IrcClock::Update();
 		(p_clObject->*Method)(fd, sWhat);
 	}
 };
@@ -0,0 +1,140 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IrcGlob.h"
+
+void IrcGlob::Compile(const std::string &strPattern, IrcCaseMapping eCaseMapping) {
+	const unsigned char * const pLower = IrcGetLowerTable(eCaseMapping);
+
+	m_eCaseMapping = eCaseMapping;
+	m_strBytes.clear();
+	m_strAny.clear();
+	m_vSegmentEnds.clear();
+	m_bStar = m_bFallback = false;
+	m_strPattern.clear();
+
+	bool bAny = false;
+
+	for (size_t i = 0; i < strPattern.size(); ++i) {
+		char c = strPattern[i];
+
+		if (c == '*') {
+			// Runs of '*' are one separator
+			if (!m_bStar || m_vSegmentEnds.back() != m_strBytes.size())
+				m_vSegmentEnds.push_back(m_strBytes.size());
+
+			m_bStar = true;
+			continue;
+		}
+
+		if (c == '?') {
+			m_strBytes += '\0';
+			m_strAny += '\1';
+			bAny = true;
+			continue;
+		}
+
+		if (c == '\\') {
+			if (i+1 == strPattern.size()) {
+				m_bFallback = true;
+				m_strPattern = strPattern;
+				return;
+			}
+
+			c = strPattern[++i];
+		}
+
+		m_strBytes += (char)pLower[(unsigned char)c];
+		m_strAny += '\0';
+	}
+
+	m_vSegmentEnds.push_back(m_strBytes.size());
+
+	if (!bAny)
+		m_strAny.clear();
+}
+
+bool IrcGlob::Matches(const char *pString, size_t length) const {
+	if (m_bFallback)
+		return IrcMatch(m_strPattern.c_str(), pString, m_eCaseMapping);
+
+	if (!m_bStar)
+		return length == m_strBytes.size() && SegmentMatches(0, m_strBytes.size(), pString);
+
+	if (length < m_strBytes.size())
+		return false;
+
+	const size_t prefixEnd = m_vSegmentEnds.front();
+	const size_t suffixBegin = m_vSegmentEnds[m_vSegmentEnds.size()-2];
+	const size_t suffixLength = m_strBytes.size() - suffixBegin;
+
+	if (!SegmentMatches(0, prefixEnd, pString) ||
+		!SegmentMatches(suffixBegin, m_strBytes.size(), pString + length - suffixLength)) {
+		return false;
+	}
+
+	// The leftmost match of each middle segment leaves the most room for the rest
+	const char *p = pString + prefixEnd;
+	const char * const pEnd = pString + length - suffixLength;
+
+	for (size_t i = 1; i+1 < m_vSegmentEnds.size(); ++i) {
+		const size_t begin = m_vSegmentEnds[i-1], end = m_vSegmentEnds[i];
+
+		p = FindSegment(begin, end, p, pEnd - p);
+
+		if (p == NULL)
+			return false;
+
+		p += end - begin;
+	}
+
+	return true;
+}
+
+bool IrcGlob::SegmentMatches(size_t begin, size_t end, const char *pString) const {
+	const unsigned char * const pLower = IrcGetLowerTable(m_eCaseMapping);
+
+	for (size_t i = begin; i < end; ++i, ++pString) {
+		if (pLower[(unsigned char)*pString] != (unsigned char)m_strBytes[i] && (m_strAny.empty() || m_strAny[i] == '\0'))
+			return false;
+	}
+
+	return true;
+}
+
+const char * IrcGlob::FindSegment(size_t begin, size_t end, const char *pString, size_t length) const {
+	const size_t segmentLength = end - begin;
+
+	// Folded bytes fold to themselves, so without '?' this is a plain case folded search
+	if (m_strAny.empty() || m_strAny.find('\1', begin) >= end)
+		return IrcStrCaseFind(pString, length, m_strBytes.data() + begin, segmentLength, m_eCaseMapping);
+
+	for (size_t i = 0; i + segmentLength <= length; ++i) {
+		if (SegmentMatches(begin, end, pString + i))
+			return pString + i;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,85 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCGLOB_H
+#define IRCGLOB_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "IrcString.h"
+#include "IrcStringView.h"
+
+// A pattern for IrcMatch() compiled for repeated matching
+// The pattern is split on '*' into segments of case folded bytes and '?' positions. The first
+// and last segments are anchored, so most strings are rejected on length or anchors alone.
+
+class IrcGlob {
+public:
+	IrcGlob() {
+		Compile("*");
+	}
+
+	explicit IrcGlob(const std::string &strPattern, IrcCaseMapping eCaseMapping = ASCII) {
+		Compile(strPattern, eCaseMapping);
+	}
+
+	void Compile(const std::string &strPattern, IrcCaseMapping eCaseMapping = ASCII);
+
+	// Same result as IrcMatch() with the pattern and case mapping
+	bool Matches(const char *pString, size_t length) const;
+
+	bool Matches(const char *pString) const {
+		return Matches(pString, strlen(pString));
+	}
+
+	bool Matches(const std::string &strString) const {
+		return Matches(strString.c_str(), strString.size());
+	}
+
+	bool Matches(const IrcStringView &clString) const {
+		return Matches(clString.c_str(), clString.size());
+	}
+
+private:
+	IrcCaseMapping m_eCaseMapping;
+
+	// Folded bytes of every segment back to back, '?' positions are marked in m_strAny (empty without any)
+	std::string m_strBytes, m_strAny;
+
+	// Where each segment ends in m_strBytes
+	std::vector<size_t> m_vSegmentEnds;
+
+	bool m_bStar;
+
+	// A trailing lone '\' has odd semantics in IrcMatch(), such patterns are matched with it
+	bool m_bFallback;
+	std::string m_strPattern;
+
+	bool SegmentMatches(size_t begin, size_t end, const char *pString) const;
+	const char * FindSegment(size_t begin, size_t end, const char *pString, size_t length) const;
+};
+
+#endif // !IRCGLOB_H
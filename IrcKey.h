@@ -0,0 +1,87 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCKEY_H
+#define IRCKEY_H
+
+#include <string>
+#include "IrcString.h"
+
+// An IRC name with its case folded form and hash computed once
+// Keys compare on the folded form, so lookups need no IrcStrCaseCmp()
+
+class IrcKey {
+public:
+	IrcKey() {
+		Set(std::string(), ASCII);
+	}
+
+	explicit IrcKey(const std::string &strString, IrcCaseMapping eCaseMapping = ASCII) {
+		Set(strString, eCaseMapping);
+	}
+
+	void Set(const std::string &strString, IrcCaseMapping eCaseMapping = ASCII);
+
+	const std::string & GetString() const {
+		return m_strString;
+	}
+
+	const std::string & GetFolded() const {
+		return m_strFolded;
+	}
+
+	unsigned int GetHash() const {
+		return m_hash;
+	}
+
+	IrcCaseMapping GetCaseMapping() const {
+		return m_eCaseMapping;
+	}
+
+	bool Empty() const {
+		return m_strString.empty();
+	}
+
+	// NOTE: Both keys should use the same case mapping
+	bool operator==(const IrcKey &clKey) const {
+		return m_hash == clKey.m_hash && m_strFolded == clKey.m_strFolded;
+	}
+
+	bool operator!=(const IrcKey &clKey) const {
+		return !(*this == clKey);
+	}
+
+	// Orders on the folded form for std::map
+	bool operator<(const IrcKey &clKey) const {
+		return m_strFolded < clKey.m_strFolded;
+	}
+
+private:
+	std::string m_strString, m_strFolded;
+	unsigned int m_hash;
+	IrcCaseMapping m_eCaseMapping;
+};
+
+#endif // !IRCKEY_H
@@ -0,0 +1,46 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IrcMask.h"
+
+void IrcMask::Compile(const IrcUser &clMask) {
+	const std::string strHostname = clMask.GetHostname().str();
+
+	m_clNickname.Compile(clMask.GetNickname().str());
+	m_clUsername.Compile(clMask.GetUsername().str());
+	m_clHostname.Compile(strHostname);
+
+	m_prefixLength = 0;
+	m_bCidr = strHostname.find('/') != std::string::npos && m_clPrefix.ParseCidr(strHostname.c_str(), m_prefixLength);
+}
+
+bool IrcMask::HostnameMatches(const IrcStringView &clHostname) const {
+	if (m_clHostname.Matches(clHostname))
+		return true;
+
+	IrcAddress clAddress;
+
+	return m_bCidr && clAddress.Parse(clHostname.c_str()) && clAddress.HasPrefix(m_clPrefix, m_prefixLength);
+}
@@ -0,0 +1,63 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCMASK_H
+#define IRCMASK_H
+
+#include "IrcGlob.h"
+#include "IrcUser.h"
+#include "IrcAddress.h"
+
+// An IrcUser hostmask compiled for repeated matching, same result as IrcUser::Matches()
+class IrcMask {
+public:
+	IrcMask() {
+		Compile(IrcUser());
+	}
+
+	explicit IrcMask(const IrcUser &clMask) {
+		Compile(clMask);
+	}
+
+	void Compile(const IrcUser &clMask);
+
+	// The hostname is tried first, it rejects the most users
+	bool Matches(const IrcUser &clUser) const {
+		return HostnameMatches(clUser.GetHostname()) &&
+			m_clNickname.Matches(clUser.GetNickname()) &&
+			m_clUsername.Matches(clUser.GetUsername());
+	}
+
+private:
+	IrcGlob m_clNickname, m_clUsername, m_clHostname;
+
+	bool m_bCidr;
+	IrcAddress m_clPrefix;
+	unsigned int m_prefixLength;
+
+	bool HostnameMatches(const IrcStringView &clHostname) const;
+};
+
+#endif // !IRCMASK_H
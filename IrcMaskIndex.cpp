@@ -0,0 +1,342 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include "IrcMaskIndex.h"
+
+namespace {
+
+bool IsWildcard(char c) {
+	return c == '*' || c == '?' || c == '\\';
+}
+
+} // end namespace
+
+unsigned int IrcMaskIndex::Insert(const IrcUser &clMask) {
+	const unsigned int mask = (unsigned int)m_vIds.size();
+	const unsigned int id = (unsigned int)m_vMasks.size();
+
+	m_vIds.push_back(id);
+	m_vMasks.push_back(IrcMask(clMask));
+
+	std::string strFolded;
+
+	if (IsLiteral(clMask.GetNickname())) {
+		Fold(clMask.GetNickname(), strFolded);
+		m_mapNicknames[strFolded].push_back(id);
+		return mask;
+	}
+
+	IrcAddress clPrefix;
+	unsigned int prefixLength = 0;
+
+	if (clPrefix.ParseCidr(clMask.GetHostname().c_str(), prefixLength)) {
+		m_clCidrTree.Insert(clPrefix, prefixLength, id);
+		return mask;
+	}
+
+	std::string strSuffix;
+	std::vector<IrcStringView> vSuffixLabels;
+	GetSuffixLabels(clMask.GetHostname(), strSuffix, vSuffixLabels);
+
+	if (vSuffixLabels.size() >= 2) {
+		m_clSuffixTrie.Insert(vSuffixLabels, id);
+		return mask;
+	}
+
+	// Something like *.com narrows less than a literal username
+	if (IsLiteral(clMask.GetUsername())) {
+		Fold(clMask.GetUsername(), strFolded);
+		m_mapUsernames[strFolded].push_back(id);
+		return mask;
+	}
+
+	std::string strPrefix;
+	std::vector<IrcStringView> vPrefixLabels;
+	GetPrefixLabels(clMask.GetHostname(), strPrefix, vPrefixLabels);
+
+	if (vPrefixLabels.size() > vSuffixLabels.size())
+		m_clPrefixTrie.Insert(vPrefixLabels, id);
+	else if (!vSuffixLabels.empty())
+		m_clSuffixTrie.Insert(vSuffixLabels, id);
+	else
+		m_vResidual.push_back(id);
+
+	return mask;
+}
+
+void IrcMaskIndex::Delete(unsigned int mask) {
+	// The id stays in its bucket, FindMatch() skips ids missing from m_vIds
+	m_vIds.erase(m_vIds.begin() + mask);
+
+	if (m_vMasks.size() - m_vIds.size() > m_vIds.size())
+		Compact();
+}
+
+unsigned int IrcMaskIndex::FindMatch(const IrcUser &clUser) const {
+	std::vector<const Bucket *> &vBuckets = m_vBuckets;
+
+	vBuckets.clear();
+
+	Fold(clUser.GetNickname(), m_strFolded);
+
+	BucketMap::const_iterator itr = m_mapNicknames.find(m_strFolded);
+
+	if (itr != m_mapNicknames.end())
+		vBuckets.push_back(&itr->second);
+
+	Fold(clUser.GetUsername(), m_strFolded);
+
+	itr = m_mapUsernames.find(m_strFolded);
+
+	if (itr != m_mapUsernames.end())
+		vBuckets.push_back(&itr->second);
+
+	if (!m_vResidual.empty())
+		vBuckets.push_back(&m_vResidual);
+
+	IrcAddress clAddress;
+
+	if (clAddress.Parse(clUser.GetHostname().c_str()))
+		m_clCidrTree.Collect(clAddress, vBuckets);
+
+	// The labels are views into m_strFolded, so it's left alone from here on
+	Fold(clUser.GetHostname(), m_strFolded);
+	SplitLabels(m_strFolded, m_vLabels);
+
+	m_clPrefixTrie.Collect(m_vLabels, vBuckets);
+
+	std::reverse(m_vLabels.begin(), m_vLabels.end());
+	m_clSuffixTrie.Collect(m_vLabels, vBuckets);
+
+	// Buckets are sorted, so merge them and try candidates in insertion order
+	std::vector<size_t> &vPositions = m_vPositions;
+
+	vPositions.assign(vBuckets.size(), 0);
+
+	for ( ; ; ) {
+		size_t bucket = vBuckets.size();
+		unsigned int id = NO_MATCH;
+
+		for (size_t i = 0; i < vBuckets.size(); ++i) {
+			if (vPositions[i] < vBuckets[i]->size() && (*vBuckets[i])[vPositions[i]] < id) {
+				bucket = i;
+				id = (*vBuckets[i])[vPositions[i]];
+			}
+		}
+
+		if (bucket == vBuckets.size())
+			return NO_MATCH;
+
+		++vPositions[bucket];
+
+		std::vector<unsigned int>::const_iterator idItr = std::lower_bound(m_vIds.begin(), m_vIds.end(), id);
+
+		// Deleted
+		if (idItr == m_vIds.end() || *idItr != id)
+			continue;
+
+		if (m_vMasks[id].Matches(clUser))
+			return (unsigned int)(idItr - m_vIds.begin());
+	}
+}
+
+void IrcMaskIndex::Reset() {
+	m_vIds.clear();
+	m_vMasks.clear();
+	m_clSuffixTrie.Reset();
+	m_clPrefixTrie.Reset();
+	m_clCidrTree.Reset();
+	m_mapNicknames.clear();
+	m_mapUsernames.clear();
+	m_vResidual.clear();
+}
+
+void IrcMaskIndex::Compact() {
+	// Ids become positions
+	std::vector<unsigned int> vIds(m_vMasks.size(), (unsigned int)IrcCidrTree::NO_VALUE);
+
+	for (size_t i = 0; i < m_vIds.size(); ++i) {
+		vIds[m_vIds[i]] = (unsigned int)i;
+		m_vMasks[i] = m_vMasks[m_vIds[i]];
+		m_vIds[i] = (unsigned int)i;
+	}
+
+	m_vMasks.erase(m_vMasks.begin() + m_vIds.size(), m_vMasks.end());
+
+	m_clSuffixTrie.Renumber(vIds);
+	m_clPrefixTrie.Renumber(vIds);
+	m_clCidrTree.Renumber(vIds);
+
+	RenumberMap(m_mapNicknames, vIds);
+	RenumberMap(m_mapUsernames, vIds);
+
+	IrcCidrTree::Renumber(m_vResidual, vIds);
+}
+
+void IrcMaskIndex::RenumberMap(BucketMap &mapBuckets, const std::vector<unsigned int> &vIds) {
+	BucketMap::iterator itr = mapBuckets.begin();
+
+	while (itr != mapBuckets.end()) {
+		IrcCidrTree::Renumber(itr->second, vIds);
+
+		if (itr->second.empty())
+			mapBuckets.erase(itr++);
+		else
+			++itr;
+	}
+}
+
+bool IrcMaskIndex::IsLiteral(const IrcStringView &clPattern) {
+	for (size_t i = 0; i < clPattern.size(); ++i) {
+		if (IsWildcard(clPattern[i]))
+			return false;
+	}
+
+	return true;
+}
+
+void IrcMaskIndex::Fold(const IrcStringView &clString, std::string &strFolded) {
+	const unsigned char * const pLower = IrcCaseTable<ASCII>::s_aLower;
+
+	strFolded.assign(clString.data(), clString.size());
+
+	// IrcUser::Matches() uses the ASCII case mapping
+	for (size_t i = 0; i < strFolded.size(); ++i)
+		strFolded[i] = (char)pLower[(unsigned char)strFolded[i]];
+}
+
+void IrcMaskIndex::SplitLabels(const IrcStringView &clHostname, std::vector<IrcStringView> &vLabels) {
+	vLabels.clear();
+
+	size_t p = 0;
+
+	for (size_t q = 0; q < clHostname.size(); ++q) {
+		if (clHostname[q] == '.') {
+			vLabels.push_back(IrcStringView(clHostname.data() + p, q-p));
+			p = q+1;
+		}
+	}
+
+	vLabels.push_back(IrcStringView(clHostname.data() + p, clHostname.size()-p));
+}
+
+void IrcMaskIndex::GetPrefixLabels(const IrcStringView &clPattern, std::string &strFolded, std::vector<IrcStringView> &vLabels) {
+	vLabels.clear();
+
+	size_t p = 0;
+
+	while (p < clPattern.size() && !IsWildcard(clPattern[p]))
+		++p;
+
+	if (p == clPattern.size()) {
+		Fold(clPattern, strFolded);
+		SplitLabels(strFolded, vLabels);
+		return;
+	}
+
+	// The last label before a wildcard may be partial
+	while (p > 0 && clPattern[p-1] != '.')
+		--p;
+
+	if (p > 0) {
+		Fold(IrcStringView(clPattern.data(), p-1), strFolded);
+		SplitLabels(strFolded, vLabels);
+	}
+}
+
+void IrcMaskIndex::GetSuffixLabels(const IrcStringView &clPattern, std::string &strFolded, std::vector<IrcStringView> &vLabels) {
+	vLabels.clear();
+
+	size_t p = clPattern.size();
+
+	while (p > 0 && !IsWildcard(clPattern[p-1]))
+		--p;
+
+	if (p == 0) {
+		Fold(clPattern, strFolded);
+		SplitLabels(strFolded, vLabels);
+	}
+	else {
+		// The first label after a wildcard may be partial
+		while (p < clPattern.size() && clPattern[p] != '.')
+			++p;
+
+		if (p < clPattern.size()) {
+			Fold(IrcStringView(clPattern.data() + p+1, clPattern.size() - (p+1)), strFolded);
+			SplitLabels(strFolded, vLabels);
+		}
+	}
+
+	std::reverse(vLabels.begin(), vLabels.end());
+}
+
+void IrcMaskIndex::LabelTrie::Insert(const std::vector<IrcStringView> &vLabels, unsigned int id) {
+	unsigned int node = 0;
+
+	for (size_t i = 0; i < vLabels.size(); ++i) {
+		std::vector<Child> &vChildren = m_vNodes[node].vChildren;
+		std::vector<Child>::iterator itr = std::lower_bound(vChildren.begin(), vChildren.end(), vLabels[i], ChildLess());
+
+		if (itr != vChildren.end() && vLabels[i] == itr->strLabel) {
+			node = itr->node;
+			continue;
+		}
+
+		Child clChild;
+		clChild.strLabel = vLabels[i].str();
+		clChild.node = (unsigned int)m_vNodes.size();
+
+		// Before m_vNodes grows and moves vChildren
+		vChildren.insert(itr, clChild);
+		m_vNodes.push_back(Node());
+
+		node = clChild.node;
+	}
+
+	m_vNodes[node].vMasks.push_back(id);
+}
+
+void IrcMaskIndex::LabelTrie::Collect(const std::vector<IrcStringView> &vLabels, std::vector<const Bucket *> &vBuckets) const {
+	unsigned int node = 0;
+
+	for (size_t i = 0; i < vLabels.size(); ++i) {
+		const std::vector<Child> &vChildren = m_vNodes[node].vChildren;
+		std::vector<Child>::const_iterator itr = std::lower_bound(vChildren.begin(), vChildren.end(), vLabels[i], ChildLess());
+
+		if (itr == vChildren.end() || vLabels[i] != itr->strLabel)
+			break;
+
+		node = itr->node;
+
+		if (!m_vNodes[node].vMasks.empty())
+			vBuckets.push_back(&m_vNodes[node].vMasks);
+	}
+}
+
+void IrcMaskIndex::LabelTrie::Renumber(const std::vector<unsigned int> &vIds) {
+	for (size_t i = 0; i < m_vNodes.size(); ++i)
+		IrcCidrTree::Renumber(m_vNodes[i].vMasks, vIds);
+}
@@ -0,0 +1,147 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCMASKINDEX_H
+#define IRCMASKINDEX_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "IrcUser.h"
+#include "IrcMask.h"
+#include "IrcCidrTree.h"
+
+// Finds the first of many hostmasks matching a user without trying every mask
+// Each mask lands in one bucket: its literal nickname, its CIDR hostname (radix tree),
+// the complete labels of its literal hostname suffix or prefix (label tries), its
+// literal username, or a short residual list. Masks are numbered by position like the owner's list and lookups return the lowest
+// matching number, so the result is the same as a linear scan.
+
+class IrcMaskIndex {
+public:
+	enum { NO_MATCH = 0xffffffff };
+
+	IrcMaskIndex() {
+		Reset();
+	}
+
+	// Appends the mask, returns its number
+	unsigned int Insert(const IrcUser &clMask);
+
+	// Later masks move down one like they do in the owner's vector
+	void Delete(unsigned int mask);
+
+	// NOTE: Not reentrant, it folds and collects into scratch members that are reused between lookups
+	unsigned int FindMatch(const IrcUser &clUser) const;
+
+	size_t GetSize() const {
+		return m_vIds.size();
+	}
+
+	void Reset();
+
+private:
+	typedef std::vector<unsigned int> Bucket;
+	typedef std::map<std::string, Bucket> BucketMap;
+
+	// Keyed on folded labels, walked from the first label given
+	class LabelTrie {
+	public:
+		LabelTrie() {
+			Reset();
+		}
+
+		void Insert(const std::vector<IrcStringView> &vLabels, unsigned int id);
+
+		// Adds the non-empty bucket of every node along the path
+		void Collect(const std::vector<IrcStringView> &vLabels, std::vector<const Bucket *> &vBuckets) const;
+
+		void Renumber(const std::vector<unsigned int> &vIds);
+
+		void Reset() {
+			m_vNodes.assign(1, Node());
+		}
+
+	private:
+		struct Child {
+			std::string strLabel;
+			unsigned int node;
+		};
+
+		struct ChildLess {
+			bool operator()(const Child &clChild, const IrcStringView &clLabel) const {
+				return IrcStringView(clChild.strLabel) < clLabel;
+			}
+		};
+
+		// Children are sorted by label so they can be found by view
+		struct Node {
+			std::vector<Child> vChildren;
+			Bucket vMasks;
+		};
+
+		// m_vNodes[0] is the root
+		std::vector<Node> m_vNodes;
+	};
+
+	// Buckets hold ids, they're only renumbered once deleted masks outnumber the rest
+	// m_vIds lists the ids of the masks still there in order, a mask's number is its position
+	std::vector<unsigned int> m_vIds;
+
+	// Compiled, tried for every candidate, indexed by id
+	std::vector<IrcMask> m_vMasks;
+
+	// Hostname labels from the right and from the left
+	LabelTrie m_clSuffixTrie, m_clPrefixTrie;
+
+	IrcCidrTree m_clCidrTree;
+
+	BucketMap m_mapNicknames, m_mapUsernames;
+	Bucket m_vResidual;
+
+	// Scratch for FindMatch()
+	mutable std::string m_strFolded;
+	mutable std::vector<IrcStringView> m_vLabels;
+	mutable std::vector<const Bucket *> m_vBuckets;
+	mutable std::vector<size_t> m_vPositions;
+
+	void Compact();
+
+	static void RenumberMap(BucketMap &mapBuckets, const std::vector<unsigned int> &vIds);
+
+	static bool IsLiteral(const IrcStringView &clPattern);
+
+	// Folds into strFolded, which keeps its storage between calls
+	static void Fold(const IrcStringView &clString, std::string &strFolded);
+
+	// The labels are views into clHostname
+	static void SplitLabels(const IrcStringView &clHostname, std::vector<IrcStringView> &vLabels);
+
+	// Complete labels before the first wildcard and after the last one, in trie order, as views into strFolded
+	static void GetPrefixLabels(const IrcStringView &clPattern, std::string &strFolded, std::vector<IrcStringView> &vLabels);
+	static void GetSuffixLabels(const IrcStringView &clPattern, std::string &strFolded, std::vector<IrcStringView> &vLabels);
+};
+
+#endif // !IRCMASKINDEX_H
@@ -0,0 +1,191 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "IrcMessageTags.h"
+
+namespace {
+	// Parses exactly numDigits digits
+	bool ParseNumber(const char *&p, int numDigits, int &iValue) {
+		iValue = 0;
+
+		for (int i = 0; i < numDigits; ++i, ++p) {
+			if (*p < '0' || *p > '9')
+				return false;
+
+			iValue = 10*iValue + (*p - '0');
+		}
+
+		return true;
+	}
+
+	bool ParseSeparator(const char *&p, char c) {
+		if (*p != c)
+			return false;
+
+		++p;
+
+		return true;
+	}
+
+	// Days since 1970-01-01 of a proleptic Gregorian date, the inverse of what gmtime() does
+	long DaysFromCivil(int iYear, int iMonth, int iDay) {
+		iYear -= iMonth <= 2;
+
+		const long era = (iYear >= 0 ? iYear : iYear-399) / 400;
+		const long yearOfEra = iYear - era*400;
+		const long dayOfYear = (153*(iMonth + (iMonth > 2 ? -3 : 9)) + 2)/5 + iDay-1;
+		const long dayOfEra = yearOfEra*365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+
+		return era*146097 + dayOfEra - 719468;
+	}
+} // end namespace
+
+void IrcMessageTags::Parse(const char *pTags) {
+	Reset();
+
+	const char *p = pTags;
+
+	while (*p != '\0' && m_size < MAX_TAGS) {
+		const char *pKey = p;
+
+		for ( ; *p != '\0' && *p != ';' && *p != '='; ++p);
+
+		const char *pKeyEnd = p, *pValue = p;
+
+		if (*p == '=') {
+			pValue = ++p;
+
+			for ( ; *p != '\0' && *p != ';'; ++p);
+		}
+
+		if (pKeyEnd != pKey) {
+			Tag &clTag = m_aTags[m_size++];
+
+			clTag.clKey = IrcStringView(pKey, pKeyEnd - pKey);
+			clTag.clValue = IrcStringView(pValue, p - pValue);
+		}
+
+		if (*p == ';')
+			++p;
+	}
+}
+
+bool IrcMessageTags::GetValue(const char *pKey, std::string &strValue) const {
+	const size_t i = Find(pKey);
+
+	if (i >= m_size)
+		return false;
+
+	Unescape(m_aTags[i].clValue, strValue);
+
+	return true;
+}
+
+bool IrcMessageTags::GetServerTime(time_t &serverTime) const {
+	const size_t i = Find("time");
+
+	if (i >= m_size)
+		return false;
+
+	// YYYY-MM-DDThh:mm:ss.sssZ never needs unescaping, but the view isn't '\0' terminated
+	char aBuff[32];
+
+	const IrcStringView &clValue = m_aTags[i].clValue;
+
+	if (clValue.size() >= sizeof(aBuff))
+		return false;
+
+	memcpy(aBuff, clValue.data(), clValue.size());
+	aBuff[clValue.size()] = '\0';
+
+	const char *p = aBuff;
+	int iYear, iMonth, iDay, iHour, iMinute, iSecond;
+
+	if (!ParseNumber(p, 4, iYear) || !ParseSeparator(p, '-') || !ParseNumber(p, 2, iMonth) ||
+		!ParseSeparator(p, '-') || !ParseNumber(p, 2, iDay) || !ParseSeparator(p, 'T') ||
+		!ParseNumber(p, 2, iHour) || !ParseSeparator(p, ':') || !ParseNumber(p, 2, iMinute) ||
+		!ParseSeparator(p, ':') || !ParseNumber(p, 2, iSecond)) {
+		return false;
+	}
+
+	if (*p == '.') {
+		for (++p; *p >= '0' && *p <= '9'; ++p);
+	}
+
+	if (*p != 'Z' || p[1] != '\0')
+		return false;
+
+	if (iMonth < 1 || iMonth > 12 || iDay < 1 || iDay > 31 || iHour > 23 || iMinute > 59 || iSecond > 60)
+		return false;
+
+	serverTime = (time_t)(DaysFromCivil(iYear, iMonth, iDay)*86400L + iHour*3600L + iMinute*60L + iSecond);
+
+	return true;
+}
+
+void IrcMessageTags::Unescape(const IrcStringView &clValue, std::string &strValue) {
+	strValue.clear();
+	strValue.reserve(clValue.size());
+
+	for (size_t i = 0; i < clValue.size(); ++i) {
+		if (clValue[i] != '\\') {
+			strValue.push_back(clValue[i]);
+			continue;
+		}
+
+		// A trailing backslash is dropped
+		if (++i >= clValue.size())
+			break;
+
+		switch (clValue[i]) {
+		case ':':
+			strValue.push_back(';');
+			break;
+		case 's':
+			strValue.push_back(' ');
+			break;
+		case 'r':
+			strValue.push_back('\r');
+			break;
+		case 'n':
+			strValue.push_back('\n');
+			break;
+		default:
+			// Including "\\"
+			strValue.push_back(clValue[i]);
+			break;
+		}
+	}
+}
+
+size_t IrcMessageTags::Find(const char *pKey) const {
+	for (size_t i = 0; i < m_size; ++i) {
+		if (m_aTags[i].clKey == pKey)
+			return i;
+	}
+
+	return m_size;
+}
@@ -0,0 +1,94 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCMESSAGETAGS_H
+#define IRCMESSAGETAGS_H
+
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include "IrcStringView.h"
+
+// The IRCv3 tags of a line ("@key=value;key2 :prefix COMMAND ...") as views into the line itself
+// Values are kept escaped, GetValue() decodes them on access.
+// NOTE: The views are only valid while the line is being processed
+
+class IrcMessageTags {
+public:
+	// Tags past this are ignored
+	enum { MAX_TAGS = 16 };
+
+	IrcMessageTags() {
+		Reset();
+	}
+
+	// pTags is the tag section without the leading '@'
+	void Parse(const char *pTags);
+
+	size_t GetSize() const {
+		return m_size;
+	}
+
+	bool IsEmpty() const {
+		return m_size == 0;
+	}
+
+	// Client-only tags keep their '+'
+	const IrcStringView & GetKey(size_t i) const {
+		return m_aTags[i].clKey;
+	}
+
+	const IrcStringView & GetRawValue(size_t i) const {
+		return m_aTags[i].clValue;
+	}
+
+	bool Has(const char *pKey) const {
+		return Find(pKey) < m_size;
+	}
+
+	// Tags without a value give an empty string
+	bool GetValue(const char *pKey, std::string &strValue) const;
+
+	// The server-time tag as wall clock seconds (fractions are dropped)
+	bool GetServerTime(time_t &serverTime) const;
+
+	void Reset() {
+		m_size = 0;
+	}
+
+	static void Unescape(const IrcStringView &clValue, std::string &strValue);
+
+private:
+	struct Tag {
+		IrcStringView clKey, clValue;
+	};
+
+	Tag m_aTags[MAX_TAGS];
+	size_t m_size;
+
+	size_t Find(const char *pKey) const;
+};
+
+#endif // !IRCMESSAGETAGS_H
@@ -24,70 +24,166 @@
  */
 
 #include <cstddef>
+#include <cstdio>
 #include <cctype>
 #include <cstring>
 #include "IrcString.h"
 
-int IrcToUpper(int c, IrcCaseMapping mapping) {
+template<>
+const unsigned char IrcCaseTable<RFC1459>::s_aLower[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x5e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+template<>
+const unsigned char IrcCaseTable<RFC1459>::s_aUpper[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x7e, 0x5f,
+	0x60, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+template<>
+const unsigned char IrcCaseTable<STRICT_RFC1459>::s_aLower[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+template<>
+const unsigned char IrcCaseTable<STRICT_RFC1459>::s_aUpper[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+template<>
+const unsigned char IrcCaseTable<ASCII>::s_aLower[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x6b, 0x6c, 0x6d, 0x6e, 0x6f,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+template<>
+const unsigned char IrcCaseTable<ASCII>::s_aUpper[256] = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+	0x60, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f,
+	0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+	0xb0, 0xb1, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xbb, 0xbc, 0xbd, 0xbe, 0xbf,
+	0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+	0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+	0xe0, 0xe1, 0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xeb, 0xec, 0xed, 0xee, 0xef,
+	0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+
+const unsigned char * IrcGetLowerTable(IrcCaseMapping mapping) {
 	switch (mapping) {
 	case RFC1459:
-		switch (c) {
-		case '{':
-			return '[';
-		case '}':
-			return ']';
-		case '|':
-			return '\\';
-		case '^':
-			return '~';
-		}
-		break;
+		return IrcCaseTable<RFC1459>::s_aLower;
 	case STRICT_RFC1459:
-		switch (c) {
-		case '{':
-			return '[';
-		case '}':
-			return ']';
-		case '|':
-			return '\\';
-		}
-		break;
+		return IrcCaseTable<STRICT_RFC1459>::s_aLower;
 	case ASCII:
 		break;
 	}
 
-	return toupper(c);
+	return IrcCaseTable<ASCII>::s_aLower;
 }
 
-int IrcToLower(int c, IrcCaseMapping mapping) {
+int IrcToUpper(int c, IrcCaseMapping mapping) {
+	// Like toupper(), EOF passes through and negative (signed) char values index as unsigned char
+	if (c == EOF || c < -128 || c > 255)
+		return c;
+
 	switch (mapping) {
 	case RFC1459:
-		switch (c) {
-		case '[':
-			return '{';
-		case ']':
-			return '}';
-		case '\\':
-			return '|';
-		case '~':
-			return '^';
-		}
-		break;
+		return IrcCaseTable<RFC1459>::s_aUpper[(unsigned char)c];
 	case STRICT_RFC1459:
-		switch (c) {
-		case '[':
-			return '{';
-		case ']':
-			return '}';
-		case '\\':
-			return '|';
-		}
-		break;
+		return IrcCaseTable<STRICT_RFC1459>::s_aUpper[(unsigned char)c];
 	case ASCII:
 		break;
 	}
 
-	return tolower(c);
+	return IrcCaseTable<ASCII>::s_aUpper[(unsigned char)c];
+}
+
+int IrcToLower(int c, IrcCaseMapping mapping) {
+	if (c == EOF || c < -128 || c > 255)
+		return c;
+
+	return IrcGetLowerTable(mapping)[(unsigned char)c];
 }
 
 int IrcIsPunct(int c, IrcCaseMapping mapping) {
@@ -140,6 +236,12 @@ int IrcIsSpecial(int c) {
 	return 0;
 }
 
+namespace {
+	bool IrcIsNickChar(int c) {
+		return c == '-' || IrcIsSpecial(c) || isalnum((unsigned char)c);
+	}
+} // end namespace
+
 bool IrcIsHostmask(const char *pString) {
 	if (pString == NULL || *pString == '!')
 		return false;
@@ -169,31 +271,33 @@ bool IrcIsNickname(const char *pString) {
 }
 
 int IrcStrCaseCmp(const char *pString1, const char *pString2, IrcCaseMapping mapping) {
-	for ( ; *pString1 != '\0' && 
-		*pString2 != '\0' && 
-		IrcToLower(*pString1, mapping) == IrcToLower(*pString2, mapping); ++pString1, ++pString2);
+	switch (mapping) {
+	case RFC1459:
+		return IrcStrCaseCmp<RFC1459>(pString1, pString2);
+	case STRICT_RFC1459:
+		return IrcStrCaseCmp<STRICT_RFC1459>(pString1, pString2);
+	case ASCII:
+		break;
+	}
 
-	return IrcToLower(*pString1, mapping)-IrcToLower(*pString2, mapping);
+	return IrcStrCaseCmp<ASCII>(pString1, pString2);
 }
 
-char * IrcStrCaseStr(const char *pBig, const char *pLittle, IrcCaseMapping mapping) {
-	const char *pMatch = NULL, *pLittleCurrent = pLittle;
-
-	for ( ; *pBig != '\0' && *pLittleCurrent != '\0'; ++pBig) {
-		if (IrcToLower(*pLittleCurrent, mapping) != IrcToLower(*pBig, mapping)) {
-			pMatch = NULL;
-			pLittleCurrent = pLittle;
-		}
-
-		if (IrcToLower(*pLittleCurrent, mapping) == IrcToLower(*pBig, mapping)) {
-			if (pMatch == NULL)
-				pMatch = pBig;
-
-			++pLittleCurrent;
-		}
+unsigned int IrcStrCaseHash(const char *pString, IrcCaseMapping mapping) {
+	switch (mapping) {
+	case RFC1459:
+		return IrcStrCaseHash<RFC1459>(pString);
+	case STRICT_RFC1459:
+		return IrcStrCaseHash<STRICT_RFC1459>(pString);
+	case ASCII:
+		break;
 	}
 
-	return *pLittleCurrent != '\0' ? NULL : (char *)pMatch;
+	return IrcStrCaseHash<ASCII>(pString);
+}
+
+char * IrcStrCaseStr(const char *pBig, const char *pLittle, IrcCaseMapping mapping) {
+	return (char *)IrcStrCaseFind(pBig, strlen(pBig), pLittle, strlen(pLittle), mapping);
 }
 
 char * IrcStrCaseWord(const char *pBig, const char *pWord, IrcCaseMapping mapping) {
@@ -215,24 +319,65 @@ char * IrcStrCaseWord(const char *pBig, const char *pWord, IrcCaseMapping mappin
 }
 
 char * IrcStrCaseNick(const char *pBig, const char *pNick, IrcCaseMapping mapping) {
-	while (*pBig != '\0') {
-		for ( ; *pBig != '\0' && !IrcIsSpecial(*pBig) && !isalpha(*pBig); ++pBig);
+	const size_t nickLength = strlen(pNick);
+	const char * const pEnd = pBig + strlen(pBig);
 
-		const char *pMatch = pBig;
-		const char *pNickCurrent = pNick;
+	for (const char *p = pBig; (p = IrcStrCaseFind(p, pEnd - p, pNick, nickLength, mapping)) != NULL; ++p) {
+		if (IrcIsNickChar(p[nickLength]) || (!isalpha((unsigned char)*p) && !IrcIsSpecial(*p)))
+			continue;
 
-		for ( ; *pBig != '\0' && *pNickCurrent != '\0' && IrcToLower(*pNickCurrent, mapping) == IrcToLower(*pBig, mapping); ++pBig, ++pNickCurrent);
+		// A word starts at its first letter or special, leading digits and '-' are skipped
+		const char *q = p;
 
-		if (*pNickCurrent == '\0' && (*pBig == '\0' || (*pBig != '-' && !IrcIsSpecial(*pBig) && !isalnum(*pBig))))
-			return (char *)pMatch;
+		for ( ; q != pBig && (q[-1] == '-' || isdigit((unsigned char)q[-1])); --q);
 
-		for ( ; *pBig != '\0' && (*pBig == '-' || IrcIsSpecial(*pBig) || isalnum(*pBig)); ++pBig);
+		if (q == pBig || !IrcIsNickChar(q[-1]))
+			return (char *)p;
 	}
 
 	return NULL;
 }
 
 bool IrcMatch(const char *pPattern, const char *pString, IrcCaseMapping mapping) {
+	switch (mapping) {
+	case RFC1459:
+		return IrcMatch<RFC1459>(pPattern, pString);
+	case STRICT_RFC1459:
+		return IrcMatch<STRICT_RFC1459>(pPattern, pString);
+	case ASCII:
+		break;
+	}
+
+	return IrcMatch<ASCII>(pPattern, pString);
+}
+
+template<IrcCaseMapping Mapping>
+int IrcStrCaseCmp(const char *pString1, const char *pString2) {
+	const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+	const unsigned char *p1 = (const unsigned char *)pString1, *p2 = (const unsigned char *)pString2;
+
+	for ( ; *p1 != '\0' && pLower[*p1] == pLower[*p2]; ++p1, ++p2);
+
+	return pLower[*p1] - pLower[*p2];
+}
+
+template<IrcCaseMapping Mapping>
+unsigned int IrcStrCaseHash(const char *pString) {
+	const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+	unsigned int hash = 2166136261u;
+
+	for (const unsigned char *p = (const unsigned char *)pString; *p != '\0'; ++p) {
+		hash ^= pLower[*p];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+template<IrcCaseMapping Mapping>
+bool IrcMatch(const char *pPattern, const char *pString) {
+	const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+
 	if (pPattern == NULL || pString == NULL)
 		return false;
 
@@ -260,7 +405,7 @@ bool IrcMatch(const char *pPattern, const char *pString, IrcCaseMapping mapping)
 			if (*pPattern == '\\')
 				++pPattern;
 
-			if (IrcToLower(*pPattern, mapping) != IrcToLower(*pString, mapping)) {
+			if (pLower[(unsigned char)*pPattern] != pLower[(unsigned char)*pString]) {
 				if (pPatternLast == NULL || *pStringLast == '\0')
 					return false;
 
@@ -283,3 +428,15 @@ bool IrcMatch(const char *pPattern, const char *pString, IrcCaseMapping mapping)
 	return *pPattern == '\0' && *pString == '\0';
 }
 
+// Instantiations for each mapping
+template int IrcStrCaseCmp<RFC1459>(const char *pString1, const char *pString2);
+template int IrcStrCaseCmp<STRICT_RFC1459>(const char *pString1, const char *pString2);
+template int IrcStrCaseCmp<ASCII>(const char *pString1, const char *pString2);
+
+template unsigned int IrcStrCaseHash<RFC1459>(const char *pString);
+template unsigned int IrcStrCaseHash<STRICT_RFC1459>(const char *pString);
+template unsigned int IrcStrCaseHash<ASCII>(const char *pString);
+
+template bool IrcMatch<RFC1459>(const char *pPattern, const char *pString);
+template bool IrcMatch<STRICT_RFC1459>(const char *pPattern, const char *pString);
+template bool IrcMatch<ASCII>(const char *pPattern, const char *pString);
@@ -26,8 +26,27 @@
 #ifndef IRCSTRING_H
 #define IRCSTRING_H
 
+#include <cstddef>
+
 enum IrcCaseMapping { RFC1459 = 0, STRICT_RFC1459, ASCII };
 
+// Case folding tables indexed by unsigned char
+template<IrcCaseMapping Mapping>
+struct IrcCaseTable {
+	static const unsigned char s_aLower[256];
+	static const unsigned char s_aUpper[256];
+};
+
+template<> const unsigned char IrcCaseTable<RFC1459>::s_aLower[256];
+template<> const unsigned char IrcCaseTable<RFC1459>::s_aUpper[256];
+template<> const unsigned char IrcCaseTable<STRICT_RFC1459>::s_aLower[256];
+template<> const unsigned char IrcCaseTable<STRICT_RFC1459>::s_aUpper[256];
+template<> const unsigned char IrcCaseTable<ASCII>::s_aLower[256];
+template<> const unsigned char IrcCaseTable<ASCII>::s_aUpper[256];
+
+// Returns the table for a mapping chosen at run time
+const unsigned char * IrcGetLowerTable(IrcCaseMapping mapping);
+
 int IrcToUpper(int c, IrcCaseMapping mapping = ASCII);
 
 int IrcToLower(int c, IrcCaseMapping mapping = ASCII);
@@ -40,15 +59,33 @@ bool IrcIsHostmask(const char *pString);
 
 bool IrcIsNickname(const char *pString);
 
+// Bytes compare as unsigned char after folding
 int IrcStrCaseCmp(const char *pString1, const char *pString2, IrcCaseMapping mapping = ASCII);
 
+// FNV-1a over the case folded string (equal under IrcStrCaseCmp implies equal hashes)
+unsigned int IrcStrCaseHash(const char *pString, IrcCaseMapping mapping = ASCII);
+
+// Case folded substring search over known lengths (SSE2/AVX2 where available), NULL for an empty pLittle
+const char * IrcStrCaseFind(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength, IrcCaseMapping mapping = ASCII);
+
 char * IrcStrCaseStr(const char *pBig, const char *pLittle, IrcCaseMapping mapping = ASCII);
 
 char * IrcStrCaseWord(const char *pBig, const char *pWord, IrcCaseMapping mapping = ASCII);
 
+// Finds pLittle, a valid nickname, as a whole word
 char * IrcStrCaseNick(const char *pBig, const char *pLittle, IrcCaseMapping mapping = ASCII);
 
 bool IrcMatch(const char *pPattern, const char *pString, IrcCaseMapping mapping = ASCII);
 
+// The same with the mapping fixed at compile time, instantiated for each IrcCaseMapping
+template<IrcCaseMapping Mapping>
+int IrcStrCaseCmp(const char *pString1, const char *pString2);
+
+template<IrcCaseMapping Mapping>
+unsigned int IrcStrCaseHash(const char *pString);
+
+template<IrcCaseMapping Mapping>
+bool IrcMatch(const char *pPattern, const char *pString);
+
 #endif // !IRCSTRING_H
 
@@ -0,0 +1,168 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "IrcStringPool.h"
+
+IrcStringPool::Handle IrcStringPool::Intern(const char *pString) {
+	const unsigned int hash = IrcStrCaseHash(pString, m_eCaseMapping);
+
+	size_t slot = FindSlot(pString, hash);
+
+	if (m_vTable[slot] != INVALID_HANDLE) {
+		AddRef(m_vTable[slot]);
+		return m_vTable[slot];
+	}
+
+	Handle hString;
+
+	if (m_vFreeHandles.empty()) {
+		hString = (Handle)m_vEntries.size();
+		m_vEntries.push_back(Entry());
+	}
+	else {
+		hString = m_vFreeHandles.back();
+		m_vFreeHandles.pop_back();
+	}
+
+	Entry &clEntry = m_vEntries[hString];
+
+	clEntry.offset = (unsigned int)m_vArena.size();
+	clEntry.refCount = 1;
+	clEntry.hash = hash;
+
+	m_vArena.insert(m_vArena.end(), pString, pString + strlen(pString) + 1);
+
+	m_vTable[slot] = hString;
+
+	if (++m_size*4 > m_vTable.size()*3)
+		Grow();
+
+	return hString;
+}
+
+IrcStringPool::Handle IrcStringPool::Find(const char *pString) const {
+	return m_vTable[FindSlot(pString, IrcStrCaseHash(pString, m_eCaseMapping))];
+}
+
+void IrcStringPool::Release(Handle hString) {
+	Entry &clEntry = m_vEntries[hString];
+
+	if (--clEntry.refCount > 0)
+		return;
+
+	const char *pString = Get(hString);
+
+	EraseSlot(FindSlot(pString, clEntry.hash));
+
+	m_garbageSize += strlen(pString) + 1;
+	m_vFreeHandles.push_back(hString);
+	--m_size;
+
+	if (m_garbageSize > 4096 && m_garbageSize*2 > m_vArena.size())
+		Compact();
+}
+
+void IrcStringPool::Reset() {
+	m_vArena.clear();
+	m_vEntries.clear();
+	m_vFreeHandles.clear();
+	m_vTable.assign(16, INVALID_HANDLE);
+	m_size = m_garbageSize = 0;
+}
+
+size_t IrcStringPool::FindSlot(const char *pString, unsigned int hash) const {
+	const size_t mask = m_vTable.size()-1;
+
+	// Linear probing, the table is never full
+	for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+		const Handle hString = m_vTable[slot];
+
+		if (hString == INVALID_HANDLE)
+			return slot;
+
+		if (m_vEntries[hString].hash == hash && !IrcStrCaseCmp(Get(hString), pString, m_eCaseMapping))
+			return slot;
+	}
+}
+
+void IrcStringPool::EraseSlot(size_t slot) {
+	const size_t mask = m_vTable.size()-1;
+
+	// Backward shift deletion so that no tombstones are needed
+	size_t next = (slot + 1) & mask;
+
+	for ( ; m_vTable[next] != INVALID_HANDLE; next = (next + 1) & mask) {
+		const size_t home = m_vEntries[m_vTable[next]].hash & mask;
+
+		// Can the entry at next be moved to slot without leaving its probe sequence?
+		if (((next - home) & mask) >= ((next - slot) & mask)) {
+			m_vTable[slot] = m_vTable[next];
+			slot = next;
+		}
+	}
+
+	m_vTable[slot] = INVALID_HANDLE;
+}
+
+void IrcStringPool::Grow() {
+	std::vector<Handle> vTable(m_vTable.size()*2, INVALID_HANDLE);
+	const size_t mask = vTable.size()-1;
+
+	for (size_t i = 0; i < m_vTable.size(); ++i) {
+		const Handle hString = m_vTable[i];
+
+		if (hString == INVALID_HANDLE)
+			continue;
+
+		size_t slot = m_vEntries[hString].hash & mask;
+
+		for ( ; vTable[slot] != INVALID_HANDLE; slot = (slot + 1) & mask);
+
+		vTable[slot] = hString;
+	}
+
+	m_vTable.swap(vTable);
+}
+
+void IrcStringPool::Compact() {
+	std::vector<char> vArena;
+	vArena.reserve(m_vArena.size() - m_garbageSize);
+
+	for (size_t i = 0; i < m_vEntries.size(); ++i) {
+		Entry &clEntry = m_vEntries[i];
+
+		if (clEntry.refCount == 0)
+			continue;
+
+		const char *pString = &m_vArena[clEntry.offset];
+
+		clEntry.offset = (unsigned int)vArena.size();
+		vArena.insert(vArena.end(), pString, pString + strlen(pString) + 1);
+	}
+
+	m_vArena.swap(vArena);
+	m_garbageSize = 0;
+}
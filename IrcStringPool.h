@@ -0,0 +1,157 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCSTRINGPOOL_H
+#define IRCSTRINGPOOL_H
+
+#include <cstddef>
+#include <vector>
+#include "IrcString.h"
+
+// Reference counted string interning
+// Strings that are equal under the case mapping share one handle (and the first spelling seen)
+
+class IrcStringPool {
+public:
+	typedef unsigned int Handle;
+
+	enum { INVALID_HANDLE = 0xffffffff };
+
+	// Holds one reference to an interned string
+	class Ref {
+	public:
+		Ref()
+		: m_pPool(NULL), m_hString(INVALID_HANDLE) { }
+
+		Ref(IrcStringPool &clPool, const char *pString)
+		: m_pPool(&clPool), m_hString(clPool.Intern(pString)) { }
+
+		Ref(const Ref &clRef)
+		: m_pPool(clRef.m_pPool), m_hString(clRef.m_hString) {
+			if (m_pPool != NULL)
+				m_pPool->AddRef(m_hString);
+		}
+
+		~Ref() {
+			if (m_pPool != NULL)
+				m_pPool->Release(m_hString);
+		}
+
+		Ref & operator=(const Ref &clRef) {
+			// AddRef first in case both refer to the same string
+			if (clRef.m_pPool != NULL)
+				clRef.m_pPool->AddRef(clRef.m_hString);
+
+			if (m_pPool != NULL)
+				m_pPool->Release(m_hString);
+
+			m_pPool = clRef.m_pPool;
+			m_hString = clRef.m_hString;
+
+			return *this;
+		}
+
+		Handle GetHandle() const {
+			return m_hString;
+		}
+
+		// NOTE: Only valid until the pool's next Intern() or Release()
+		const char * Get() const {
+			return m_pPool != NULL ? m_pPool->Get(m_hString) : "";
+		}
+
+		// Strings from the same pool are equal exactly when their handles are
+		bool operator==(const Ref &clRef) const {
+			return m_hString == clRef.m_hString;
+		}
+
+		bool operator!=(const Ref &clRef) const {
+			return !(*this == clRef);
+		}
+
+	private:
+		IrcStringPool *m_pPool;
+		Handle m_hString;
+	};
+
+	explicit IrcStringPool(IrcCaseMapping eCaseMapping = ASCII) {
+		m_eCaseMapping = eCaseMapping;
+		Reset();
+	}
+
+	IrcCaseMapping GetCaseMapping() const {
+		return m_eCaseMapping;
+	}
+
+	// Adds a reference
+	Handle Intern(const char *pString);
+
+	// Does not add a reference
+	Handle Find(const char *pString) const;
+
+	void AddRef(Handle hString) {
+		++m_vEntries[hString].refCount;
+	}
+
+	void Release(Handle hString);
+
+	// NOTE: Only valid until the next Intern() or Release()
+	const char * Get(Handle hString) const {
+		return &m_vArena[m_vEntries[hString].offset];
+	}
+
+	unsigned int GetHash(Handle hString) const {
+		return m_vEntries[hString].hash;
+	}
+
+	// Handles are dense, so this can size tables indexed by Handle
+	size_t GetHandleLimit() const {
+		return m_vEntries.size();
+	}
+
+	size_t GetSize() const {
+		return m_size;
+	}
+
+	void Reset();
+
+private:
+	struct Entry {
+		unsigned int offset, refCount, hash;
+	};
+
+	IrcCaseMapping m_eCaseMapping;
+	std::vector<char> m_vArena;
+	std::vector<Entry> m_vEntries;
+	std::vector<Handle> m_vFreeHandles, m_vTable;
+	size_t m_size, m_garbageSize;
+
+	size_t FindSlot(const char *pString, unsigned int hash) const;
+	void EraseSlot(size_t slot);
+	void Grow();
+	void Compact();
+};
+
+#endif // !IRCSTRINGPOOL_H
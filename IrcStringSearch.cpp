@@ -0,0 +1,208 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstring>
+#include "IrcString.h"
+
+// Case folded substring search with SSE2 and AVX2 kernels picked at run time
+// The kernels compare the folded first and last characters of the needle against a block of
+// candidate positions at once and only verify the candidates that pass both
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define IRC_USE_SSE2 1
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define IRC_USE_AVX2 1
+#endif // defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IRC_USE_SSE2 1
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
+namespace {
+	typedef const char * (*FindFunction)(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength);
+
+	template<IrcCaseMapping Mapping>
+	bool FoldedEquals(const char *pString1, const char *pString2, size_t length) {
+		const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+
+		for (size_t i = 0; i < length; ++i) {
+			if (pLower[(unsigned char)pString1[i]] != pLower[(unsigned char)pString2[i]])
+				return false;
+		}
+
+		return true;
+	}
+
+	template<IrcCaseMapping Mapping>
+	const char * FindScalar(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength) {
+		const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+		const unsigned char first = pLower[(unsigned char)pLittle[0]];
+
+		for (size_t i = 0; i + littleLength <= bigLength; ++i) {
+			if (pLower[(unsigned char)pBig[i]] == first && FoldedEquals<Mapping>(pBig + i + 1, pLittle + 1, littleLength - 1))
+				return pBig + i;
+		}
+
+		return NULL;
+	}
+
+#ifdef IRC_USE_SSE2
+	inline unsigned int CountTrailingZeros(unsigned int bits) {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, bits);
+		return index;
+#else // !_MSC_VER
+		return __builtin_ctz(bits);
+#endif // _MSC_VER
+	}
+
+	// Folding flips 0x20 on 'A'-'Z' ('A'-']' under the RFC1459 mappings) and on '~' under RFC1459
+	template<IrcCaseMapping Mapping>
+	inline __m128i FoldSse2(__m128i block) {
+		const char upperLast = Mapping == ASCII ? 'Z' : ']';
+
+		__m128i mask = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A'-1)), _mm_cmplt_epi8(block, _mm_set1_epi8(upperLast+1)));
+
+		if (Mapping == RFC1459)
+			mask = _mm_or_si128(mask, _mm_cmpeq_epi8(block, _mm_set1_epi8('~')));
+
+		return _mm_xor_si128(block, _mm_and_si128(mask, _mm_set1_epi8(0x20)));
+	}
+
+	template<IrcCaseMapping Mapping>
+	const char * FindSse2(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength) {
+		const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+		const __m128i first = _mm_set1_epi8((char)pLower[(unsigned char)pLittle[0]]);
+		const __m128i last = _mm_set1_epi8((char)pLower[(unsigned char)pLittle[littleLength-1]]);
+		const size_t middleLength = littleLength > 2 ? littleLength - 2 : 0;
+
+		size_t i = 0;
+
+		for ( ; i + littleLength + 15 <= bigLength; i += 16) {
+			const __m128i blockFirst = FoldSse2<Mapping>(_mm_loadu_si128((const __m128i *)(pBig + i)));
+			const __m128i blockLast = FoldSse2<Mapping>(_mm_loadu_si128((const __m128i *)(pBig + i + littleLength - 1)));
+
+			unsigned int bits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(blockFirst, first), _mm_cmpeq_epi8(blockLast, last)));
+
+			for ( ; bits != 0; bits &= bits - 1) {
+				const size_t j = i + CountTrailingZeros(bits);
+
+				if (FoldedEquals<Mapping>(pBig + j + 1, pLittle + 1, middleLength))
+					return pBig + j;
+			}
+		}
+
+		return FindScalar<Mapping>(pBig + i, bigLength - i, pLittle, littleLength);
+	}
+#endif // IRC_USE_SSE2
+
+#ifdef IRC_USE_AVX2
+	template<IrcCaseMapping Mapping>
+	__attribute__((target("avx2"), always_inline)) inline __m256i FoldAvx2(__m256i block) {
+		const char upperLast = Mapping == ASCII ? 'Z' : ']';
+
+		__m256i mask = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8('A'-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(upperLast+1), block));
+
+		if (Mapping == RFC1459)
+			mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(block, _mm256_set1_epi8('~')));
+
+		return _mm256_xor_si256(block, _mm256_and_si256(mask, _mm256_set1_epi8(0x20)));
+	}
+
+	template<IrcCaseMapping Mapping>
+	__attribute__((target("avx2"))) const char * FindAvx2(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength) {
+		const unsigned char * const pLower = IrcCaseTable<Mapping>::s_aLower;
+		const __m256i first = _mm256_set1_epi8((char)pLower[(unsigned char)pLittle[0]]);
+		const __m256i last = _mm256_set1_epi8((char)pLower[(unsigned char)pLittle[littleLength-1]]);
+		const size_t middleLength = littleLength > 2 ? littleLength - 2 : 0;
+
+		size_t i = 0;
+
+		for ( ; i + littleLength + 31 <= bigLength; i += 32) {
+			const __m256i blockFirst = FoldAvx2<Mapping>(_mm256_loadu_si256((const __m256i *)(pBig + i)));
+			const __m256i blockLast = FoldAvx2<Mapping>(_mm256_loadu_si256((const __m256i *)(pBig + i + littleLength - 1)));
+
+			unsigned int bits = (unsigned int)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(blockFirst, first), _mm256_cmpeq_epi8(blockLast, last)));
+
+			for ( ; bits != 0; bits &= bits - 1) {
+				const size_t j = i + __builtin_ctz(bits);
+
+				if (FoldedEquals<Mapping>(pBig + j + 1, pLittle + 1, middleLength))
+					return pBig + j;
+			}
+		}
+
+		// Avoid AVX to SSE transition stalls, the compiler may not do this before a tail call
+		_mm256_zeroupper();
+
+		// Short messages and tails still get the 16 byte kernel
+		return FindSse2<Mapping>(pBig + i, bigLength - i, pLittle, littleLength);
+	}
+#endif // IRC_USE_AVX2
+
+	template<IrcCaseMapping Mapping>
+	FindFunction SelectFind() {
+#ifdef IRC_USE_AVX2
+		if (__builtin_cpu_supports("avx2"))
+			return &FindAvx2<Mapping>;
+#endif // IRC_USE_AVX2
+
+#ifdef IRC_USE_SSE2
+		return &FindSse2<Mapping>;
+#else // !IRC_USE_SSE2
+		return &FindScalar<Mapping>;
+#endif // IRC_USE_SSE2
+	}
+
+	template<IrcCaseMapping Mapping>
+	const char * Find(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength) {
+		// Racing threads all store the same function
+		static FindFunction s_pFind = NULL;
+
+		if (s_pFind == NULL)
+			s_pFind = SelectFind<Mapping>();
+
+		return (*s_pFind)(pBig, bigLength, pLittle, littleLength);
+	}
+} // end namespace
+
+const char * IrcStrCaseFind(const char *pBig, size_t bigLength, const char *pLittle, size_t littleLength, IrcCaseMapping mapping) {
+	if (littleLength == 0 || littleLength > bigLength)
+		return NULL;
+
+	switch (mapping) {
+	case RFC1459:
+		return Find<RFC1459>(pBig, bigLength, pLittle, littleLength);
+	case STRICT_RFC1459:
+		return Find<STRICT_RFC1459>(pBig, bigLength, pLittle, littleLength);
+	case ASCII:
+		break;
+	}
+
+	return Find<ASCII>(pBig, bigLength, pLittle, littleLength);
+}
@@ -0,0 +1,114 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCSTRINGVIEW_H
+#define IRCSTRINGVIEW_H
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+// A read-only view of characters owned by someone else
+// The method names follow std::string so it can stand in for a const std::string &
+
+class IrcStringView {
+public:
+	IrcStringView()
+	: m_pData(""), m_length(0) { }
+
+	IrcStringView(const char *pData, size_t length)
+	: m_pData(pData), m_length(length) { }
+
+	// NOTE: The view is only good while the string is alive and unchanged
+	IrcStringView(const char *pString)
+	: m_pData(pString), m_length(strlen(pString)) { }
+
+	IrcStringView(const std::string &strString)
+	: m_pData(strString.c_str()), m_length(strString.size()) { }
+
+	const char * data() const {
+		return m_pData;
+	}
+
+	// NOTE: Only when the viewed characters are followed by '\0' (true of IrcUser's views and whole strings)
+	const char * c_str() const {
+		return m_pData;
+	}
+
+	size_t size() const {
+		return m_length;
+	}
+
+	size_t length() const {
+		return m_length;
+	}
+
+	bool empty() const {
+		return m_length == 0;
+	}
+
+	char operator[](size_t i) const {
+		return m_pData[i];
+	}
+
+	// Copies are spelled out, there is no implicit conversion to hide the allocation
+	std::string str() const {
+		return std::string(m_pData, m_length);
+	}
+
+	bool operator==(const IrcStringView &clString) const {
+		return m_length == clString.m_length && !memcmp(m_pData, clString.m_pData, m_length);
+	}
+
+	bool operator==(const char *pString) const {
+		return *this == IrcStringView(pString, strlen(pString));
+	}
+
+	bool operator==(const std::string &strString) const {
+		return *this == IrcStringView(strString.data(), strString.size());
+	}
+
+	template<typename StringType>
+	bool operator!=(const StringType &clString) const {
+		return !(*this == clString);
+	}
+
+	// Byte order, a prefix sorts first
+	bool operator<(const IrcStringView &clString) const {
+		const int iCmp = memcmp(m_pData, clString.m_pData, std::min(m_length, clString.m_length));
+		return iCmp < 0 || (iCmp == 0 && m_length < clString.m_length);
+	}
+
+private:
+	const char *m_pData;
+	size_t m_length;
+};
+
+inline std::ostream & operator<<(std::ostream &os, const IrcStringView &clString) {
+	return os.write(clString.data(), clString.size());
+}
+
+#endif // !IRCSTRINGVIEW_H
@@ -0,0 +1,383 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include "IrcClock.h"
+#include "IrcTimerWheel.h"
+
+namespace {
+
+long DiffMs(const struct timeval &stTv1, const struct timeval &stTv2) {
+	return (long)(stTv1.tv_sec - stTv2.tv_sec)*1000 + (long)(stTv1.tv_usec - stTv2.tv_usec)/1000;
+}
+
+void AddMs(struct timeval &stTv, long ms) {
+	stTv.tv_sec += ms / 1000;
+	stTv.tv_usec += (ms % 1000)*1000;
+
+	if (stTv.tv_usec >= 1000000) {
+		++stTv.tv_sec;
+		stTv.tv_usec -= 1000000;
+	}
+}
+
+} // end namespace
+
+IrcTimerWheel::TimerId IrcTimerWheel::NewTimer(const IrcEvent &clCallback, bool bPersist) {
+	TimerId timer = m_freeTimer;
+
+	if (timer == NO_TIMER) {
+		timer = (TimerId)m_vTimers.size();
+		m_vTimers.push_back(Timer());
+	}
+	else {
+		m_freeTimer = m_vTimers[timer].next;
+	}
+
+	Timer &clTimer = m_vTimers[timer];
+
+	clTimer.clCallback = clCallback;
+	clTimer.periodTicks = 0;
+	clTimer.expireTick = 0;
+	clTimer.list = NO_LIST;
+	clTimer.prev = clTimer.next = NO_TIMER;
+	clTimer.bPersist = bPersist;
+
+	return timer;
+}
+
+void IrcTimerWheel::FreeTimer(TimerId timer) {
+	Timer &clTimer = m_vTimers[timer];
+
+	if (clTimer.list != NO_LIST)
+		Unlink(timer);
+
+	clTimer.clCallback = IrcEvent();
+	clTimer.next = m_freeTimer;
+	m_freeTimer = timer;
+}
+
+bool IrcTimerWheel::Schedule(TimerId timer, unsigned int delayMs) {
+	if (m_vTimers[timer].list != NO_LIST)
+		Unlink(timer);
+
+	struct timeval stNow;
+	GetNow(stNow);
+
+	// An idle wheel does not keep time, so start counting from now
+	if (m_scheduledCount == 0 && !m_bRunning) {
+		m_tickTime = stNow;
+		m_targetTick = m_currentTick;
+	}
+
+	Timer &clTimer = m_vTimers[timer];
+
+	if (delayMs == 0 && !clTimer.bPersist) {
+		Link(IMMEDIATE_LIST, timer);
+	}
+	else {
+		// Ticks are counted from when the current tick was due and rounded up, so one-shot timers never run early
+		long sinceTick = DiffMs(stNow, m_tickTime);
+
+		if (sinceTick < 0)
+			sinceTick = 0;
+
+		// Split so delays near UINT_MAX don't overflow a 32 bit long
+		unsigned int ticks = delayMs / TICK_MS + (unsigned int)((sinceTick + delayMs % TICK_MS + TICK_MS - 1) / TICK_MS);
+
+		if (ticks == 0)
+			ticks = 1;
+
+		if (clTimer.bPersist) {
+			clTimer.periodTicks = (delayMs + TICK_MS - 1) / TICK_MS;
+
+			if (clTimer.periodTicks == 0)
+				clTimer.periodTicks = 1;
+
+			// The first run may be up to half a period early, later ones keep the period
+			ticks -= rand() % (clTimer.periodTicks/2 + 1);
+
+			if (ticks == 0)
+				ticks = 1;
+		}
+
+		clTimer.expireTick = m_currentTick + ticks;
+		Insert(timer);
+	}
+
+	// The libevent timer is only moved up for a timer due before it
+	if (!m_bRunning && (!m_bArmed || (delayMs == 0 && !m_bArmedImmediate) ||
+			(clTimer.list != IMMEDIATE_LIST && clTimer.expireTick - m_currentTick < m_armedTick - m_currentTick))) {
+		Arm();
+	}
+
+	return true;
+}
+
+bool IrcTimerWheel::Cancel(TimerId timer) {
+	if (m_vTimers[timer].list == NO_LIST)
+		return false;
+
+	Unlink(timer);
+
+	return true;
+}
+
+void IrcTimerWheel::Reset() {
+	m_vTimers.clear();
+	m_freeTimer = NO_TIMER;
+	m_scheduledCount = 0;
+
+	for (unsigned int i = 0; i < NUM_LISTS; ++i)
+		m_aLists[i].head = m_aLists[i].tail = NO_TIMER;
+
+	m_currentTick = m_targetTick = m_armedTick = 0;
+	m_tickTime.tv_sec = m_tickTime.tv_usec = 0;
+
+	m_bArmed = m_bArmedImmediate = m_bRunning = false;
+	m_clTickEvent.Delete();
+}
+
+void IrcTimerWheel::Insert(TimerId timer) {
+	Timer &clTimer = m_vTimers[timer];
+	const unsigned int mask = SLOTS-1;
+
+	const unsigned int delta = clTimer.expireTick - m_currentTick;
+	unsigned int level = 0;
+	unsigned int slotTick = clTimer.expireTick;
+
+	for ( ; level+1 < LEVELS && delta >= (1u << ((level+1)*LEVEL_BITS)); ++level);
+
+	// Beyond the top level, wait in the last slot it reaches and go around again when that is cascaded
+	// expireTick keeps the real expiry, so the timer is never run early
+	if (level+1 == LEVELS && delta >= (1u << (LEVELS*LEVEL_BITS)))
+		slotTick = m_currentTick + (1u << (LEVELS*LEVEL_BITS)) - 1;
+
+	Link(level*SLOTS + ((slotTick >> (level*LEVEL_BITS)) & mask), timer);
+}
+
+void IrcTimerWheel::Link(unsigned int list, TimerId timer) {
+	Timer &clTimer = m_vTimers[timer];
+	List &clList = m_aLists[list];
+
+	clTimer.list = list;
+	clTimer.prev = clList.tail;
+	clTimer.next = NO_TIMER;
+
+	if (clList.tail == NO_TIMER)
+		clList.head = timer;
+	else
+		m_vTimers[clList.tail].next = timer;
+
+	clList.tail = timer;
+
+	++m_scheduledCount;
+}
+
+void IrcTimerWheel::Unlink(TimerId timer) {
+	Timer &clTimer = m_vTimers[timer];
+	List &clList = m_aLists[clTimer.list];
+
+	if (clTimer.prev == NO_TIMER)
+		clList.head = clTimer.next;
+	else
+		m_vTimers[clTimer.prev].next = clTimer.next;
+
+	if (clTimer.next == NO_TIMER)
+		clList.tail = clTimer.prev;
+	else
+		m_vTimers[clTimer.next].prev = clTimer.prev;
+
+	clTimer.list = NO_LIST;
+	clTimer.prev = clTimer.next = NO_TIMER;
+
+	--m_scheduledCount;
+}
+
+void IrcTimerWheel::Cascade(unsigned int level) {
+	const unsigned int list = level*SLOTS + ((m_currentTick >> (level*LEVEL_BITS)) & (SLOTS-1));
+
+	// Every timer here is due within this level's slot, so each lands in a lower level
+	// Top level timers due later than that land in a later top level slot
+	while (m_aLists[list].head != NO_TIMER) {
+		const TimerId timer = m_aLists[list].head;
+
+		Unlink(timer);
+		Insert(timer);
+	}
+}
+
+void IrcTimerWheel::RunList(unsigned int list, size_t maxCount) {
+	// Callbacks may schedule, cancel or free any timer, so always start from the list's head
+	for (size_t i = 0; i < maxCount && m_aLists[list].head != NO_TIMER; ++i) {
+		const TimerId timer = m_aLists[list].head;
+
+		Unlink(timer);
+
+		Timer &clTimer = m_vTimers[timer];
+
+		// Missed periods are not run again
+		if (clTimer.bPersist) {
+			clTimer.expireTick = m_targetTick + clTimer.periodTicks;
+			Insert(timer);
+		}
+
+		const IrcEvent clCallback = clTimer.clCallback;
+
+		clCallback(-1, EV_TIMEOUT);
+	}
+}
+
+void IrcTimerWheel::Advance(const struct timeval &stNow) {
+	long elapsed = DiffMs(stNow, m_tickTime);
+
+	// Only a virtual clock goes backwards
+	if (elapsed < 0) {
+		m_tickTime = stNow;
+		return;
+	}
+
+	m_targetTick = m_currentTick + (unsigned int)(elapsed / TICK_MS);
+
+	while (m_currentTick != m_targetTick) {
+		// Ticks in between have nothing to run or cascade
+		unsigned int ticks = NextTick() - m_currentTick;
+
+		if (ticks > m_targetTick - m_currentTick)
+			ticks = m_targetTick - m_currentTick;
+
+		m_currentTick += ticks;
+		AddMs(m_tickTime, (long)ticks*TICK_MS);
+
+		if ((m_currentTick & (SLOTS-1)) == 0) {
+			for (unsigned int level = 1; level < LEVELS; ++level) {
+				Cascade(level);
+
+				if (((m_currentTick >> (level*LEVEL_BITS)) & (SLOTS-1)) != 0)
+					break;
+			}
+		}
+
+		RunList(m_currentTick & (SLOTS-1), (size_t)-1);
+	}
+}
+
+unsigned int IrcTimerWheel::NextTick() const {
+	const unsigned int mask = SLOTS-1;
+	unsigned int nextTicks = 0;
+
+	// Level 0 slots hold timers due in the next SLOTS-1 ticks
+	for (unsigned int i = 1; i < SLOTS; ++i) {
+		if (m_aLists[(m_currentTick + i) & mask].head != NO_TIMER) {
+			nextTicks = i;
+			break;
+		}
+	}
+
+	// Higher level slots are cascaded on the first tick of their span
+	for (unsigned int level = 1; level < LEVELS; ++level) {
+		const unsigned int shift = level*LEVEL_BITS;
+
+		for (unsigned int i = 1; i <= SLOTS; ++i) {
+			const unsigned int tick = ((m_currentTick >> shift) + i) << shift;
+			const unsigned int ticks = tick - m_currentTick;
+
+			if (nextTicks != 0 && ticks >= nextTicks)
+				break;
+
+			if (m_aLists[level*SLOTS + ((tick >> shift) & mask)].head != NO_TIMER) {
+				nextTicks = ticks;
+				break;
+			}
+		}
+	}
+
+	return m_currentTick + (nextTicks != 0 ? nextTicks : SLOTS);
+}
+
+void IrcTimerWheel::Arm() {
+	if (m_pEventBase == NULL)
+		return;
+
+	if (!m_clTickEvent)
+		m_clTickEvent.NewTimer(m_pEventBase, 0);
+
+	struct timeval stTv;
+	stTv.tv_sec = stTv.tv_usec = 0;
+
+	m_bArmedImmediate = m_aLists[IMMEDIATE_LIST].head != NO_TIMER;
+	m_armedTick = m_currentTick;
+
+	if (!m_bArmedImmediate) {
+		if (m_scheduledCount == 0) {
+			m_clTickEvent.Delete();
+			m_bArmed = false;
+			return;
+		}
+
+		m_armedTick = NextTick();
+
+		// At most SLOTS^LEVELS ticks away, that fits in a 32 bit long
+		struct timeval stDue = m_tickTime;
+		AddMs(stDue, (long)(m_armedTick - m_currentTick)*TICK_MS);
+
+		struct timeval stNow;
+		GetNow(stNow);
+
+		long untilTick = DiffMs(stDue, stNow);
+
+		if (untilTick > 0)
+			AddMs(stTv, untilTick);
+	}
+
+	m_clTickEvent.Add(&stTv);
+	m_bArmed = true;
+}
+
+void IrcTimerWheel::GetNow(struct timeval &stNow) const {
+	stNow = IrcClock::GetTime();
+}
+
+void IrcTimerWheel::OnTick(evutil_socket_t fd, short what) {
+	m_bRunning = true;
+	m_bArmed = false;
+
+	// Only those already waiting, timers added again from their callback wait for the next iteration
+	size_t immediateCount = 0;
+
+	for (TimerId timer = m_aLists[IMMEDIATE_LIST].head; timer != NO_TIMER; timer = m_vTimers[timer].next)
+		++immediateCount;
+
+	RunList(IMMEDIATE_LIST, immediateCount);
+
+	struct timeval stNow;
+	GetNow(stNow);
+
+	Advance(stNow);
+
+	m_bRunning = false;
+
+	Arm();
+}
@@ -0,0 +1,203 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCTIMERWHEEL_H
+#define IRCTIMERWHEEL_H
+
+#include <vector>
+#include "IrcEvent.h"
+#include "event2/event.h"
+
+// Many timers driven by one libevent timer
+// A hierarchical timing wheel with LEVELS levels of SLOTS slots each, one tick is TICK_MS milliseconds.
+// Timers due in the next SLOTS ticks sit in level 0, later ones cascade down as their time nears.
+// Delays beyond the top level (SLOTS^LEVELS ticks, about 19 days) go around it again, so any unsigned int delay works.
+// Zero delays skip the wheel and run on the next event loop iteration.
+// The libevent timer only fires for ticks with work (a level 0 slot with timers or a cascade of one that has any), empty ticks are skipped.
+
+class IrcTimerWheel {
+public:
+	enum { TICK_MS = 100, LEVEL_BITS = 6, SLOTS = 1 << LEVEL_BITS, LEVELS = 4 };
+	enum { NO_TIMER = 0xffffffff };
+
+	typedef unsigned int TimerId;
+
+	IrcTimerWheel() {
+		m_pEventBase = NULL;
+		m_clTickEvent = IrcEvent::Bind<IrcTimerWheel, &IrcTimerWheel::OnTick>(this);
+		Reset();
+	}
+
+	~IrcTimerWheel() {
+		m_clTickEvent.Free();
+	}
+
+	// NOTE: Call before the first timer is scheduled
+	void SetEventBase(struct event_base *pEventBase) {
+		m_pEventBase = pEventBase;
+		m_clTickEvent.Free();
+	}
+
+	struct event_base * GetEventBase() const {
+		return m_pEventBase;
+	}
+
+	// Timers are reserved until freed, whether or not they are scheduled
+	TimerId NewTimer(const IrcEvent &clCallback, bool bPersist);
+	void FreeTimer(TimerId timer);
+
+	// Replaces any earlier schedule, persistent timers repeat every delayMs
+	// The first run of a persistent timer is jittered into [delayMs/2, delayMs] to spread periodic work across ticks
+	bool Schedule(TimerId timer, unsigned int delayMs);
+	bool Cancel(TimerId timer);
+
+	bool IsScheduled(TimerId timer) const {
+		return m_vTimers[timer].list != NO_LIST;
+	}
+
+	size_t GetScheduledCount() const {
+		return m_scheduledCount;
+	}
+
+	// Drops all timers, NOTE: Outstanding IrcTimer objects become invalid
+	void Reset();
+
+private:
+	enum { NO_LIST = 0xffffffff, IMMEDIATE_LIST = LEVELS*SLOTS, NUM_LISTS = LEVELS*SLOTS + 1 };
+
+	struct Timer {
+		IrcEvent clCallback;
+		unsigned int periodTicks; // Set when a persistent timer is scheduled
+		unsigned int expireTick;
+		unsigned int list; // NO_LIST when not scheduled
+		unsigned int prev, next; // next also links free timers
+		bool bPersist;
+	};
+
+	struct List {
+		unsigned int head, tail;
+	};
+
+	struct event_base *m_pEventBase;
+	IrcEvent m_clTickEvent;
+	bool m_bArmed, m_bArmedImmediate, m_bRunning;
+
+	std::vector<Timer> m_vTimers;
+	unsigned int m_freeTimer;
+	size_t m_scheduledCount;
+
+	// One list per slot, then the immediate list
+	List m_aLists[NUM_LISTS];
+
+	// The last tick run and when it was due, m_targetTick is the last tick of the current run
+	// m_armedTick is the tick the libevent timer is set for
+	unsigned int m_currentTick, m_targetTick, m_armedTick;
+	struct timeval m_tickTime;
+
+	void Insert(TimerId timer);
+	void Link(unsigned int list, TimerId timer);
+	void Unlink(TimerId timer);
+
+	void Cascade(unsigned int level);
+	void RunList(unsigned int list, size_t maxCount);
+	void Advance(const struct timeval &stNow);
+	unsigned int NextTick() const;
+	void Arm();
+	void GetNow(struct timeval &stNow) const;
+
+	void OnTick(evutil_socket_t fd, short what);
+
+	// Timers refer back to the wheel by index
+	IrcTimerWheel(const IrcTimerWheel &);
+	IrcTimerWheel & operator=(const IrcTimerWheel &);
+};
+
+// A timer on an IrcTimerWheel with the same interface as an IrcEvent timer
+class IrcTimer {
+public:
+	IrcTimer() {
+		m_pWheel = NULL;
+		m_timer = IrcTimerWheel::NO_TIMER;
+	}
+
+	IrcTimer(const IrcTimer &clTimer) {
+		m_pWheel = NULL;
+		m_timer = IrcTimerWheel::NO_TIMER;
+		m_clCallback = clTimer.m_clCallback;
+	}
+
+	~IrcTimer() {
+		Free();
+	}
+
+	template<typename ObjectType, void (ObjectType::*Method)(evutil_socket_t fd, short sWhat)>
+	static IrcTimer Bind(ObjectType *p_clObject) {
+		IrcTimer clTimer;
+		clTimer.m_clCallback = IrcEvent::Bind<ObjectType, Method>(p_clObject);
+		return clTimer;
+	}
+
+	// sWhat is 0 or EV_PERSIST
+	bool NewTimer(IrcTimerWheel *pWheel, short sWhat) {
+		Free();
+
+		m_pWheel = pWheel;
+		m_timer = m_pWheel->NewTimer(m_clCallback, (sWhat & EV_PERSIST) != 0);
+
+		return true;
+	}
+
+	bool Add(const struct timeval *p_stTv) const {
+		return m_pWheel != NULL && m_pWheel->Schedule(m_timer, p_stTv->tv_sec*1000 + p_stTv->tv_usec/1000);
+	}
+
+	bool Delete() const {
+		return m_pWheel != NULL && m_pWheel->Cancel(m_timer);
+	}
+
+	void Free() {
+		if (m_pWheel != NULL) {
+			m_pWheel->FreeTimer(m_timer);
+			m_pWheel = NULL;
+			m_timer = IrcTimerWheel::NO_TIMER;
+		}
+	}
+
+	IrcTimer & operator=(const IrcTimer &clTimer) {
+		m_clCallback = clTimer.m_clCallback;
+		return *this;
+	}
+
+	operator bool() const {
+		return m_pWheel != NULL;
+	}
+
+private:
+	IrcTimerWheel *m_pWheel;
+	IrcTimerWheel::TimerId m_timer;
+	IrcEvent m_clCallback;
+};
+
+#endif // !IRCTIMERWHEEL_H
@@ -0,0 +1,391 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "IrcTlsSocket.h"
+
+#ifdef USE_OPENSSL
+
+#include <map>
+#include <vector>
+#include "openssl/ssl.h"
+#include "openssl/err.h"
+#include "openssl/x509v3.h"
+
+namespace {
+	// TLS 1.3 tickets are single use, so reconnecting clients each take one of the tickets collected so far
+	// A TLS 1.2 session can be resumed over and over, only the latest is kept
+	typedef std::map<std::string, std::vector<SSL_SESSION *> > SessionMap;
+
+	enum { MAX_SESSIONS_PER_SERVER = 64 };
+
+	SSL_CTX *s_pContext = NULL;
+	int s_keyIndex = -1;
+	SessionMap s_mSessions;
+
+	// Verifying and non-verifying clients never share sessions, resuming skips the certificate checks
+	// Neither do clients with different certificates, a resumed session keeps the identity it was made with
+	std::string MakeSessionKey(const std::string &strServer, const std::string &strPort, bool bVerify, const std::string &strCertFile) {
+		std::string strKey = std::string(bVerify ? "verify " : "noverify ") + strServer + ':' + strPort;
+
+		if (!strCertFile.empty())
+			strKey += " cert " + strCertFile;
+
+		return strKey;
+	}
+
+	bool IsIpAddress(const std::string &strServer) {
+		ASN1_OCTET_STRING *pAddress = a2i_IPADDRESS(strServer.c_str());
+
+		if (pAddress == NULL)
+			return false;
+
+		ASN1_OCTET_STRING_free(pAddress);
+
+		return true;
+	}
+
+	// Called for each session (or TLS 1.3 ticket) the server hands out
+	int OnNewSession(SSL *pSsl, SSL_SESSION *pSession) {
+		const std::string *pKey = (const std::string *)SSL_get_ex_data(pSsl, s_keyIndex);
+
+		if (pKey == NULL)
+			return 0;
+
+		// Only sessions from verified handshakes are good enough for verifying clients
+		if ((SSL_get_verify_mode(pSsl) & SSL_VERIFY_PEER) && SSL_get_verify_result(pSsl) != X509_V_OK)
+			return 0;
+
+		std::vector<SSL_SESSION *> &vSessions = s_mSessions[*pKey];
+
+		if (SSL_SESSION_get_protocol_version(pSession) != TLS1_3_VERSION || vSessions.size() >= MAX_SESSIONS_PER_SERVER) {
+			// Oldest first
+			const size_t numToFree = SSL_SESSION_get_protocol_version(pSession) != TLS1_3_VERSION ? vSessions.size() : 1;
+
+			for (size_t i = 0; i < numToFree; ++i)
+				SSL_SESSION_free(vSessions[i]);
+
+			vSessions.erase(vSessions.begin(), vSessions.begin() + numToFree);
+		}
+
+		// Keep the reference
+		vSessions.push_back(pSession);
+
+		return 1;
+	}
+
+	void FreeKey(void *pParent, void *pData, CRYPTO_EX_DATA *pExData, int index, long argl, void *pArgp) {
+		delete (std::string *)pData;
+	}
+
+	SSL_CTX * GetContext() {
+		if (s_pContext != NULL)
+			return s_pContext;
+
+		s_pContext = SSL_CTX_new(TLS_client_method());
+
+		if (s_pContext == NULL)
+			return NULL;
+
+		SSL_CTX_set_min_proto_version(s_pContext, TLS1_2_VERSION);
+		SSL_CTX_set_default_verify_paths(s_pContext);
+
+		// The client side cache is ours, keyed on server and port
+		SSL_CTX_set_session_cache_mode(s_pContext, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(s_pContext, &OnNewSession);
+
+		// Lines are written from a temporary buffer and partial writes are reported like send()
+		SSL_CTX_set_mode(s_pContext, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+		// Servers often close without close_notify, which would otherwise be a fatal error that spoils the session
+		SSL_CTX_set_options(s_pContext, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif // SSL_OP_IGNORE_UNEXPECTED_EOF
+
+		s_keyIndex = SSL_get_ex_new_index(0, NULL, NULL, NULL, &FreeKey);
+
+		return s_pContext;
+	}
+
+	std::string GetErrorString() {
+		char aBuff[256] = "";
+
+		unsigned long ulError = ERR_get_error();
+
+		if (ulError != 0)
+			ERR_error_string_n(ulError, aBuff, sizeof(aBuff));
+
+		ERR_clear_error();
+
+		return aBuff;
+	}
+} // end namespace
+
+IrcTlsSocket::IrcTlsSocket() {
+	m_pSsl = NULL;
+	m_bHandshakeDone = false;
+}
+
+bool IrcTlsSocket::Open(evutil_socket_t fd, const std::string &strServer, const std::string &strPort, bool bVerify, 
+	const std::string &strCertFile, const std::string &strKeyFile) {
+	Close();
+
+	SSL_CTX *pContext = GetContext();
+
+	if (pContext == NULL) {
+		m_strError = GetErrorString();
+		return false;
+	}
+
+	m_pSsl = SSL_new(pContext);
+
+	if (m_pSsl == NULL || SSL_set_fd(m_pSsl, (int)fd) != 1) {
+		m_strError = GetErrorString();
+		Close();
+		return false;
+	}
+
+	// Read on every connection, so a renewed certificate is picked up on reconnect
+	if (!strCertFile.empty()) {
+		const std::string &strKeyPath = strKeyFile.empty() ? strCertFile : strKeyFile;
+
+		if (SSL_use_certificate_chain_file(m_pSsl, strCertFile.c_str()) != 1 ||
+			SSL_use_PrivateKey_file(m_pSsl, strKeyPath.c_str(), SSL_FILETYPE_PEM) != 1 ||
+			SSL_check_private_key(m_pSsl) != 1) {
+			m_strError = "Cannot load client certificate: " + GetErrorString();
+			Close();
+			return false;
+		}
+	}
+
+	const std::string strKey = MakeSessionKey(strServer, strPort, bVerify, strCertFile);
+
+	SSL_set_ex_data(m_pSsl, s_keyIndex, new std::string(strKey));
+
+	const bool bIpAddress = IsIpAddress(strServer);
+
+	// Host names only, IP addresses don't go in SNI
+	if (!bIpAddress)
+		SSL_set_tlsext_host_name(m_pSsl, strServer.c_str());
+
+	if (bVerify) {
+		SSL_set_verify(m_pSsl, SSL_VERIFY_PEER, NULL);
+
+		// IP addresses are matched against the certificate's IP SANs instead of its names
+		const int iResult = bIpAddress ? X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(m_pSsl), strServer.c_str()) :
+			SSL_set1_host(m_pSsl, strServer.c_str());
+
+		if (iResult != 1) {
+			m_strError = GetErrorString();
+			Close();
+			return false;
+		}
+	}
+
+	SessionMap::iterator itr = s_mSessions.find(strKey);
+
+	if (itr != s_mSessions.end()) {
+		std::vector<SSL_SESSION *> &vSessions = itr->second;
+
+		while (!vSessions.empty()) {
+			SSL_SESSION * const pSession = vSessions.back();
+
+			// Sessions of connections that failed are no good
+			const bool bResumable = (SSL_SESSION_is_resumable(pSession) == 1);
+
+			if (bResumable)
+				SSL_set_session(m_pSsl, pSession);
+
+			// TLS 1.3 tickets are single use (RFC 8446 C.4), the server sends fresh ones after the handshake
+			if (!bResumable || SSL_SESSION_get_protocol_version(pSession) == TLS1_3_VERSION) {
+				vSessions.pop_back();
+				SSL_SESSION_free(pSession);
+			}
+
+			if (bResumable)
+				break;
+		}
+
+		if (vSessions.empty())
+			s_mSessions.erase(itr);
+	}
+
+	SSL_set_connect_state(m_pSsl);
+
+	return true;
+}
+
+bool IrcTlsSocket::IsOpen() const {
+	return m_pSsl != NULL;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Handshake() {
+	if (m_pSsl == NULL)
+		return RESULT_ERROR;
+
+	const ResultType eResult = GetResult(SSL_do_handshake(m_pSsl));
+
+	if (eResult == RESULT_OK)
+		m_bHandshakeDone = true;
+
+	return eResult;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Read(void *pBuffer, size_t &size) {
+	if (m_pSsl == NULL)
+		return RESULT_ERROR;
+
+	const int iReturn = SSL_read(m_pSsl, pBuffer, (int)size);
+
+	size = iReturn > 0 ? (size_t)iReturn : 0;
+
+	return GetResult(iReturn);
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Write(const void *pData, size_t &size) {
+	if (m_pSsl == NULL)
+		return RESULT_ERROR;
+
+	const int iReturn = SSL_write(m_pSsl, pData, (int)size);
+
+	size = iReturn > 0 ? (size_t)iReturn : 0;
+
+	return GetResult(iReturn);
+}
+
+bool IrcTlsSocket::HasPending() const {
+	return m_pSsl != NULL && SSL_pending(m_pSsl) > 0;
+}
+
+bool IrcTlsSocket::IsResumed() const {
+	return m_pSsl != NULL && SSL_session_reused(m_pSsl) == 1;
+}
+
+std::string IrcTlsSocket::GetDescription() const {
+	if (m_pSsl == NULL)
+		return std::string();
+
+	return std::string(SSL_get_version(m_pSsl)) + ' ' + SSL_get_cipher_name(m_pSsl);
+}
+
+void IrcTlsSocket::Close() {
+	if (m_pSsl != NULL) {
+		// Don't wait for the server's close_notify, the socket is closed right after
+		if (m_bHandshakeDone)
+			SSL_shutdown(m_pSsl);
+
+		SSL_free(m_pSsl);
+		m_pSsl = NULL;
+	}
+
+	ERR_clear_error();
+
+	m_bHandshakeDone = false;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::GetResult(int iReturn) {
+	if (iReturn > 0)
+		return RESULT_OK;
+
+	switch (SSL_get_error(m_pSsl, iReturn)) {
+	case SSL_ERROR_WANT_READ:
+		return RESULT_WANT_READ;
+	case SSL_ERROR_WANT_WRITE:
+		return RESULT_WANT_WRITE;
+	case SSL_ERROR_ZERO_RETURN:
+		return RESULT_CLOSED;
+	case SSL_ERROR_SYSCALL:
+		// Unexpected EOF from the server
+		if (ERR_peek_error() == 0) {
+			m_strError = "Connection closed";
+			return RESULT_CLOSED;
+		}
+
+		break;
+	case SSL_ERROR_SSL:
+		if ((SSL_get_verify_mode(m_pSsl) & SSL_VERIFY_PEER) && SSL_get_verify_result(m_pSsl) != X509_V_OK) {
+			m_strError = X509_verify_cert_error_string(SSL_get_verify_result(m_pSsl));
+			ERR_clear_error();
+			return RESULT_ERROR;
+		}
+
+		break;
+	}
+
+	m_strError = GetErrorString();
+
+	return RESULT_ERROR;
+}
+
+#else // !USE_OPENSSL
+
+IrcTlsSocket::IrcTlsSocket() {
+	m_bHandshakeDone = false;
+}
+
+bool IrcTlsSocket::Open(evutil_socket_t fd, const std::string &strServer, const std::string &strPort, bool bVerify, 
+	const std::string &strCertFile, const std::string &strKeyFile) {
+	m_strError = "Not built with TLS support";
+	return false;
+}
+
+bool IrcTlsSocket::IsOpen() const {
+	return false;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Handshake() {
+	return RESULT_ERROR;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Read(void *pBuffer, size_t &size) {
+	size = 0;
+	return RESULT_ERROR;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::Write(const void *pData, size_t &size) {
+	size = 0;
+	return RESULT_ERROR;
+}
+
+bool IrcTlsSocket::HasPending() const {
+	return false;
+}
+
+bool IrcTlsSocket::IsResumed() const {
+	return false;
+}
+
+std::string IrcTlsSocket::GetDescription() const {
+	return std::string();
+}
+
+void IrcTlsSocket::Close() {
+	m_bHandshakeDone = false;
+}
+
+IrcTlsSocket::ResultType IrcTlsSocket::GetResult(int iReturn) {
+	return RESULT_ERROR;
+}
+
+#endif // USE_OPENSSL
@@ -0,0 +1,99 @@
+/*-
+ * Copyright (c) 2014 Nathan Lay (nslay@users.sourceforge.net)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR(S) ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR(S) BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef IRCTLSSOCKET_H
+#define IRCTLSSOCKET_H
+
+#include <cstddef>
+#include <string>
+#include "event2/util.h"
+
+#ifdef USE_OPENSSL
+typedef struct ssl_st SSL;
+#endif // USE_OPENSSL
+
+// TLS over an already connected non-blocking socket, used in place of recv() and send()
+// Sessions are cached per server, port, verify setting and client certificate for the whole process, so reconnecting (from any client)
+// resumes with an abbreviated handshake when the server allows it. TLS 1.3 tickets are only used once.
+// Without USE_OPENSSL, Open() always fails.
+
+class IrcTlsSocket {
+public:
+	enum ResultType { RESULT_OK = 0, RESULT_WANT_READ, RESULT_WANT_WRITE, RESULT_CLOSED, RESULT_ERROR };
+
+	IrcTlsSocket();
+
+	~IrcTlsSocket() {
+		Close();
+	}
+
+	// strServer is checked against the certificate when bVerify is set
+	// strCertFile is an optional PEM client certificate (and chain), its key is read from strKeyFile or else strCertFile
+	bool Open(evutil_socket_t fd, const std::string &strServer, const std::string &strPort, bool bVerify, 
+		const std::string &strCertFile = std::string(), const std::string &strKeyFile = std::string());
+
+	bool IsOpen() const;
+
+	bool IsHandshakeDone() const {
+		return m_bHandshakeDone;
+	}
+
+	ResultType Handshake();
+
+	// Bytes read or written are returned in size
+	ResultType Read(void *pBuffer, size_t &size);
+	ResultType Write(const void *pData, size_t &size);
+
+	// Decrypted data waiting to be read without touching the socket
+	bool HasPending() const;
+
+	bool IsResumed() const;
+
+	// Protocol and cipher once the handshake is done
+	std::string GetDescription() const;
+
+	// The last error
+	const std::string & GetError() const {
+		return m_strError;
+	}
+
+	void Close();
+
+private:
+#ifdef USE_OPENSSL
+	SSL *m_pSsl;
+#endif // USE_OPENSSL
+
+	bool m_bHandshakeDone;
+	std::string m_strError;
+
+	ResultType GetResult(int iReturn);
+
+	// Sockets own their SSL objects
+	IrcTlsSocket(const IrcTlsSocket &);
+	IrcTlsSocket & operator=(const IrcTlsSocket &);
+};
+
+#endif // !IRCTLSSOCKET_H
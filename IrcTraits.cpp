@@ -23,6 +23,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstring>
 #include <limits>
 #include <sstream>
 #include "IrcTraits.h"
@@ -133,6 +134,9 @@ bool IrcTraits::Parse(const std::string &strParam) {
 		if (!(paramStream >> m_topicLen))
 			m_topicLen = 510;
 	}
+	else if (strVariable == "WHOX") {
+		m_whoX = true;
+	}
 
 	return true;
 }
@@ -157,6 +161,10 @@ void IrcTraits::Reset() {
 	m_safeList = false;
 	m_strStatusMsg.clear();
 	m_topicLen = 510;
+	m_whoX = false;
+
+	BuildChanModeTable();
+	BuildPrefixTables();
 }
 
 IrcTraits::LimitIterator IrcTraits::GetChanLimit(char prefix) const {
@@ -170,15 +178,6 @@ IrcTraits::LimitIterator IrcTraits::GetChanLimit(char prefix) const {
 	return ChanLimitEnd();
 }
 
-IrcTraits::ChanModesType IrcTraits::ClassifyChanMode(char mode) const {
-	for (int i = 0; i < 4; ++i) {
-		if (m_strChanModes[i].find(mode) != std::string::npos)
-			return (ChanModesType)i;
-	}
-
-	return TYPE_B;
-}
-
 IrcTraits::LimitIterator IrcTraits::GetMaxList(char mode) const {
 	for (LimitIterator itr = MaxListBegin(); itr != MaxListEnd(); ++itr) {
 		const std::string &strModes = itr->first;
@@ -190,22 +189,30 @@ IrcTraits::LimitIterator IrcTraits::GetMaxList(char mode) const {
 	return MaxListEnd();
 }
 
-char IrcTraits::GetPrefixByMode(char mode) const {
-	size_t p = m_prefix.first.find(mode);
+void IrcTraits::BuildChanModeTable() {
+	// Unknown modes are assumed to take a parameter
+	memset(m_chanModeTypes, TYPE_B, sizeof(m_chanModeTypes));
 
-	if (p != std::string::npos)
-		return m_prefix.second[p];
+	// Earlier types win if a mode is listed twice
+	for (int i = 3; i >= 0; --i) {
+		const std::string &strModes = m_strChanModes[i];
 
-	return '\0';
+		for (size_t j = 0; j < strModes.size(); ++j)
+			m_chanModeTypes[(unsigned char)strModes[j]] = (unsigned char)i;
+	}
 }
 
-char IrcTraits::GetModeByPrefix(char prefix) const {
-	size_t p = m_prefix.second.find(prefix);
+void IrcTraits::BuildPrefixTables() {
+	memset(m_prefixByMode, 0, sizeof(m_prefixByMode));
+	memset(m_modeByPrefix, 0, sizeof(m_modeByPrefix));
 
-	if (p != std::string::npos)
-		return m_prefix.first[p];
+	// Earlier entries win if a mode or prefix is listed twice
+	for (size_t i = m_prefix.first.size(); i-- > 0; ) {
+		const char mode = m_prefix.first[i], prefix = m_prefix.second[i];
 
-	return '\0';
+		m_prefixByMode[(unsigned char)mode] = prefix;
+		m_modeByPrefix[(unsigned char)prefix] = mode;
+	}
 }
 
 bool IrcTraits::ParseCaseMapping(const std::string &strValue) {
@@ -255,17 +262,23 @@ bool IrcTraits::ParseChanModes(const std::string &strValue) {
 	m_strChanModes[2].clear();
 	m_strChanModes[3].clear();
 
-	if (strValue.empty())
+	if (strValue.empty()) {
+		BuildChanModeTable();
 		return false;
+	}
 
 	std::stringstream paramStream(strValue);
 
-	for (int i = 0; i < 4; ++i) {
+	bool bValid = true;
+
+	for (int i = 0; bValid && i < 4; ++i) {
 		if (!std::getline(paramStream,m_strChanModes[i],','))
-			return false;
+			bValid = false;
 	}
 
-	return true;
+	BuildChanModeTable();
+
+	return bValid;
 }
 
 bool IrcTraits::ParseMaxList(const std::string &strValue) {
@@ -298,6 +311,8 @@ bool IrcTraits::ParsePrefix(const std::string &strValue) {
 	m_prefix.first.clear();
 	m_prefix.second.clear();
 
+	BuildPrefixTables();
+
 	// No prefixes apparently
 	if (strValue.empty())
 		return true;
@@ -317,6 +332,8 @@ bool IrcTraits::ParsePrefix(const std::string &strValue) {
 
 	m_prefix = std::make_pair(strModes, strPrefixes);
 
+	BuildPrefixTables();
+
 	return true;
 }
 
@@ -64,7 +64,29 @@ public:
 		return m_strChanModes[type];
 	}
 
-	ChanModesType ClassifyChanMode(char mode) const;
+	ChanModesType ClassifyChanMode(char mode) const {
+		return (ChanModesType)m_chanModeTypes[(unsigned char)mode];
+	}
+
+	// Prefix modes (e.g. +o, +v) always take a nickname
+	bool IsPrefixMode(char mode) const {
+		return m_prefixByMode[(unsigned char)mode] != '\0';
+	}
+
+	// Whether setting (bSet) or unsetting the mode consumes a parameter
+	bool HasModeParam(char mode, bool bSet) const {
+		if (IsPrefixMode(mode))
+			return true;
+
+		switch (ClassifyChanMode(mode)) {
+		case TYPE_C:
+			return bSet;
+		case TYPE_D:
+			return false;
+		default:
+			return true;
+		}
+	}
 
 	unsigned int GetChannelLen() const {
 		return m_channelLen;
@@ -112,8 +134,13 @@ public:
 		return m_prefix;
 	}
 
-	char GetPrefixByMode(char mode) const;
-	char GetModeByPrefix(char prefix) const;
+	char GetPrefixByMode(char mode) const {
+		return m_prefixByMode[(unsigned char)mode];
+	}
+
+	char GetModeByPrefix(char prefix) const {
+		return m_modeByPrefix[(unsigned char)prefix];
+	}
 
 	bool GetSafeList() const {
 		return m_safeList;
@@ -127,6 +154,10 @@ public:
 		return m_topicLen;
 	}
 
+	bool GetWhoX() const {
+		return m_whoX;
+	}
+
 private:
 	IrcCaseMapping m_caseMapping;
 	std::string m_strChanTypes, m_strNetwork, m_strStatusMsg, m_strChanModes[4];
@@ -134,7 +165,14 @@ private:
 	unsigned int m_channelLen, m_kickLen, m_modes, m_nickLen, m_topicLen;
 	char m_excepts, m_invex;
 	std::pair<std::string, std::string> m_prefix;
-	bool m_safeList;
+	bool m_safeList, m_whoX;
+
+	// Lookup tables rebuilt whenever CHANMODES or PREFIX change
+	unsigned char m_chanModeTypes[256];
+	char m_prefixByMode[256], m_modeByPrefix[256];
+
+	void BuildChanModeTable();
+	void BuildPrefixTables();
 
 	bool ParseCaseMapping(const std::string &strValue);
 	bool ParseChanLimit(const std::string &strValue);
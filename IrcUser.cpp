@@ -23,45 +23,113 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cstring>
 #include "IrcUser.h"
+#include "IrcAddress.h"
 
-void IrcUser::Parse(const std::string &strHostmask) {
-	Reset();
+IrcUser & IrcUser::operator=(const IrcUser &clUser) {
+	if (this == &clUser)
+		return *this;
 
-	if (strHostmask.empty())
-		return;
-
-	size_t p, q;
-	p = q = 0;
+	const size_t size = clUser.GetBufferSize();
 
-	q = strHostmask.find('!', p);
+	if (size > m_capacity) {
+		if (m_pBuffer != m_aBuffer)
+			delete[] m_pBuffer;
 
-	if (q == std::string::npos) {
-		SetNickname(strHostmask);
-		return;
+		m_pBuffer = new char[size];
+		m_capacity = (unsigned int)size;
 	}
 
-	SetNickname(strHostmask.substr(p,q-p));
+	memcpy(m_pBuffer, clUser.m_pBuffer, size);
 
-	p = q + 1;
+	m_userOffset = clUser.m_userOffset;
+	m_hostOffset = clUser.m_hostOffset;
+	m_length = clUser.m_length;
 
-	if (p >= strHostmask.size())
-		return;
+	return *this;
+}
 
-	q = strHostmask.find('@',p);
+void IrcUser::Parse(const char *pHostmask) {
+	const char *p = strchr(pHostmask, '!');
 
-	if (q == std::string::npos) {
-		SetUsername(strHostmask.substr(p));
+	if (p == NULL) {
+		Assign(IrcStringView(pHostmask, strlen(pHostmask)), IrcStringView(), IrcStringView());
 		return;
 	}
 
-	SetUsername(strHostmask.substr(p,q-p));
+	const IrcStringView clNickname(pHostmask, p - pHostmask);
+	const char * const pUsername = p + 1;
 
-	p = q + 1;
+	p = strchr(pUsername, '@');
 
-	if (p >= strHostmask.size())
+	if (p == NULL) {
+		Assign(clNickname, IrcStringView(pUsername, strlen(pUsername)), IrcStringView());
 		return;
+	}
 
-	SetHostname(strHostmask.substr(p));
+	Assign(clNickname, IrcStringView(pUsername, p - pUsername), IrcStringView(p + 1, strlen(p + 1)));
 }
 
+void IrcUser::Assign(IrcStringView clNickname, IrcStringView clUsername, IrcStringView clHostname) {
+	const IrcStringView clStar("*", 1);
+
+	if (clNickname.empty())
+		clNickname = clStar;
+
+	if (clUsername.empty())
+		clUsername = clStar;
+
+	if (clHostname.empty())
+		clHostname = clStar;
+
+	const size_t length = clNickname.size() + clUsername.size() + clHostname.size() + 2;
+	const size_t size = length + clNickname.size() + clUsername.size() + 3;
+
+	// The parts may be views of the current buffer, so build the new one aside
+	char aSmall[SMALL_SIZE];
+	char * const pBuffer = size <= SMALL_SIZE ? aSmall : new char[size];
+	char *p = pBuffer;
+
+	memcpy(p, clNickname.data(), clNickname.size());
+	p += clNickname.size();
+	*p++ = '!';
+	memcpy(p, clUsername.data(), clUsername.size());
+	p += clUsername.size();
+	*p++ = '@';
+	memcpy(p, clHostname.data(), clHostname.size());
+	p += clHostname.size();
+	*p++ = '\0';
+	memcpy(p, clNickname.data(), clNickname.size());
+	p += clNickname.size();
+	*p++ = '\0';
+	memcpy(p, clUsername.data(), clUsername.size());
+	p += clUsername.size();
+	*p++ = '\0';
+
+	if (pBuffer == aSmall) {
+		memcpy(m_pBuffer, aSmall, size);
+	}
+	else {
+		if (m_pBuffer != m_aBuffer)
+			delete[] m_pBuffer;
+
+		m_pBuffer = pBuffer;
+		m_capacity = (unsigned int)size;
+	}
+
+	m_userOffset = (unsigned int)clNickname.size() + 1;
+	m_hostOffset = m_userOffset + (unsigned int)clUsername.size() + 1;
+	m_length = (unsigned int)length;
+}
+
+bool IrcUser::CidrMatches(const char *pHostname) const {
+	if (memchr(GetHostname().data(), '/', GetHostname().size()) == NULL)
+		return false;
+
+	IrcAddress clPrefix, clAddress;
+	unsigned int prefixLength = 0;
+
+	return clPrefix.ParseCidr(GetHostname().c_str(), prefixLength) &&
+		clAddress.Parse(pHostname) && clAddress.HasPrefix(clPrefix, prefixLength);
+}
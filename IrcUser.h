@@ -29,79 +29,102 @@
 #include <iostream>
 #include <string>
 #include "IrcString.h"
+#include "IrcStringView.h"
 
+// One buffer holds "nick!user@host\0" followed by '\0' terminated copies of the nickname and username,
+// so every part and the hostmask are views into it. Hostmasks within the usual length limits fit in the object itself.
 class IrcUser {
 public:
 	IrcUser() { 
+		Init();
 		Reset();
 	}
 
+	explicit IrcUser(const char *pHostmask) {
+		Init();
+		Parse(pHostmask);
+	}
+
 	explicit IrcUser(const std::string &strHostmask) {
-		Parse(strHostmask);
+		Init();
+		Parse(strHostmask.c_str());
 	}
 
-	IrcUser(const std::string &strNickname, const std::string &strUsername, const std::string &strHostname) {
-		Set(strNickname, strUsername, strHostname);
+	IrcUser(IrcStringView clNickname, IrcStringView clUsername, IrcStringView clHostname) {
+		Init();
+		Assign(clNickname, clUsername, clHostname);
 	}
 
-	void Parse(const std::string &strHostmask);
+	IrcUser(const IrcUser &clUser) {
+		Init();
+		*this = clUser;
+	}
 
-	void Set(const std::string &strNickname, const std::string &strUsername, const std::string &strHostname) {
-		SetNickname(strNickname);
-		SetUsername(strUsername);
-		SetHostname(strHostname);
+	~IrcUser() {
+		if (m_pBuffer != m_aBuffer)
+			delete[] m_pBuffer;
 	}
 
-	void SetNickname(const std::string &strNickname) {
-		m_strNickname = strNickname.empty() ? "*" : strNickname;
+	IrcUser & operator=(const IrcUser &clUser);
+
+	void Parse(const char *pHostmask);
+
+	void Parse(const std::string &strHostmask) {
+		Parse(strHostmask.c_str());
 	}
 
-	void SetUsername(const std::string &strUsername) {
-		m_strUsername = strUsername.empty() ? "*" : strUsername;
+	void Set(IrcStringView clNickname, IrcStringView clUsername, IrcStringView clHostname) {
+		Assign(clNickname, clUsername, clHostname);
 	}
 
-	void SetHostname(const std::string &strHostname) {
-		m_strHostname = strHostname.empty() ? "*" : strHostname;
+	void SetNickname(IrcStringView clNickname) {
+		Assign(clNickname, GetUsername(), GetHostname());
 	}
 
-	const std::string & GetNickname() const {
-		return m_strNickname;
+	void SetUsername(IrcStringView clUsername) {
+		Assign(GetNickname(), clUsername, GetHostname());
 	}
 
-	const std::string & GetUsername() const {
-		return m_strUsername;
+	void SetHostname(IrcStringView clHostname) {
+		Assign(GetNickname(), GetUsername(), clHostname);
 	}
 
-	const std::string & GetHostname() const {
-		return m_strHostname;
+	IrcStringView GetNickname() const {
+		return IrcStringView(m_pBuffer + m_length + 1, m_userOffset - 1);
 	}
 
-	std::string GetHostmask() const {
-		std::string strHostmask = GetNickname();
-		strHostmask += '!';
-		strHostmask += GetUsername();
-		strHostmask += '@';
-		strHostmask += GetHostname();
-		return strHostmask;
+	IrcStringView GetUsername() const {
+		return IrcStringView(m_pBuffer + m_length + m_userOffset + 1, m_hostOffset - m_userOffset - 1);
+	}
+
+	IrcStringView GetHostname() const {
+		return IrcStringView(m_pBuffer + m_hostOffset, m_length - m_hostOffset);
+	}
+
+	IrcStringView GetHostmask() const {
+		return IrcStringView(m_pBuffer, m_length);
 	}
 
 	std::string GetBanMask() const {
-		std::string strHostmask = "*!*@";
-		strHostmask += GetHostname();
+		const IrcStringView clHostname = GetHostname();
+
+		std::string strHostmask;
+		strHostmask.reserve(4 + clHostname.size());
+		strHostmask += "*!*@";
+		strHostmask.append(clHostname.data(), clHostname.size());
 		return strHostmask;
 	}
 
 	void Reset() {
-		m_strNickname = '*';
-		m_strUsername = '*';
-		m_strHostname = '*';
+		Assign(IrcStringView(), IrcStringView(), IrcStringView());
 	}
 
+	// The hostname may also be CIDR (e.g. 203.0.113.0/24 or 2001:db8::/32) matching IP hostnames
 	bool Matches(const IrcUser &clUser) const {
 		return this == &clUser ||
 			(IrcMatch(GetNickname().c_str(),clUser.GetNickname().c_str()) &&
 			IrcMatch(GetUsername().c_str(),clUser.GetUsername().c_str()) &&
-			IrcMatch(GetHostname().c_str(),clUser.GetHostname().c_str()));
+			(IrcMatch(GetHostname().c_str(),clUser.GetHostname().c_str()) || CidrMatches(clUser.GetHostname().c_str())));
 	}
 
 	bool operator==(const IrcUser &clUser) const {
@@ -116,7 +139,33 @@ public:
 	}
 
 private:
-	std::string m_strNickname, m_strUsername, m_strHostname;
+	// Longest parts kept in the object: NICKLEN 30 (common today, RFC 1459 has 9), USERLEN 10 plus '~', and a 63 byte hostname
+	enum { MAX_SMALL_NICKNAME = 30, MAX_SMALL_USERNAME = 11, MAX_SMALL_HOSTNAME = 63 };
+
+	// "nick!user@host\0nick\0user\0"
+	enum { SMALL_SIZE = 2*(MAX_SMALL_NICKNAME + MAX_SMALL_USERNAME) + MAX_SMALL_HOSTNAME + 5 };
+
+	char *m_pBuffer;
+	unsigned int m_capacity;
+
+	// m_length is the hostmask's length, the copies of the nickname and username follow it
+	unsigned int m_userOffset, m_hostOffset, m_length;
+
+	char m_aBuffer[SMALL_SIZE];
+
+	void Init() {
+		m_pBuffer = m_aBuffer;
+		m_capacity = SMALL_SIZE;
+	}
+
+	size_t GetBufferSize() const {
+		return m_length + m_hostOffset + 1;
+	}
+
+	// Empty parts become "*", the parts may point into this object's own buffer
+	void Assign(IrcStringView clNickname, IrcStringView clUsername, IrcStringView clHostname);
+
+	bool CidrMatches(const char *pHostname) const;
 };
 
 inline std::istream & operator>>(std::istream &is, IrcUser &clUser) {